@@ -0,0 +1,15 @@
+TARGET = terrainbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+CONFIG -= qt
+CONFIG += release
+
+INCLUDEPATH += ../include ../src
+
+SOURCES += main.cpp
+
+LIBS += -L$$OUT_PWD/.. -lterraincore
+win32-msvc*: PRE_TARGETDEPS += $$OUT_PWD/../terraincore.lib
+else: PRE_TARGETDEPS += $$OUT_PWD/../libterraincore.a
@@ -0,0 +1,416 @@
+// Generates and meshes a square of chunks with the terraincore library
+// and reports the throughput of each stage, so terrain changes can be
+// measured without starting the game.
+//
+//   terrainbench [size] [--naive] [--scalar] [--kernel name] [--step n] [--no-caves]
+//                [--verify] [--seed n] [--origin x z] [--save dir] [--delta]
+//
+// size is the width of the square in chunks (default 16). --naive
+// meshes one quad per face instead of greedy meshing, --scalar
+// computes the heightmap without the SIMD noise kernels, --kernel
+// uses the named noise kernel (avx2, sse4.1 or scalar) instead of the
+// widest one the CPU supports, and --step
+// sets ProcedureTerrain::heightSampleStep. --no-caves skips carving
+// caves and --seed sets the world seed. --verify checks that the
+// heightmaps and cave densities from every SIMD kernel the CPU supports
+// are identical to the scalar ones, that chunks
+// generated on several threads at once match those generated one by
+// one, and that the interpolated
+// heightmap stays within maxStepError() blocks of sampling every
+// column, and exits with status 1 if not. --save writes the chunks, with
+// a few edits in every fourth one, to a world in dir and times reading
+// them back like Terrain does. --delta saves only the edits.
+
+#include "scene/chunkblocks.h"
+#include "scene/procedureterrain.h"
+#include "scene/terraingenerator.h"
+#include "scene/worldsave.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Peak resident set size of this process in bytes
+std::size_t peakRSS() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void usage(const char *program) {
+    std::fprintf(stderr, "usage: %s [size] [--naive] [--scalar] [--kernel name] [--step n] [--no-caves] [--verify] [--seed n] [--origin x z] [--save dir] [--delta]\n", program);
+}
+
+// Compares the cave densities of the area from the SIMD and the scalar
+// noise kernels on the lattice TerrainGenerator uses. Returns the number
+// of lattice points that differ.
+int verifyCaves(int x, int z, int width) {
+    const glm::ivec3 step(TerrainGenerator::CAVE_STEP_XZ, TerrainGenerator::CAVE_STEP_Y, TerrainGenerator::CAVE_STEP_XZ);
+    const glm::ivec3 count(width / step.x + 1, TerrainGenerator::CAVE_TOP / step.y + 2, width / step.z + 1);
+    const int n = count.x * count.y * count.z;
+    std::vector<float> simdDensity(n), scalarDensity(n);
+
+    ProcedureTerrain::simdNoise = true;
+    ProcedureTerrain::getCaveDensities(glm::ivec3(x, 0, z), count, step, simdDensity.data());
+    ProcedureTerrain::simdNoise = false;
+    ProcedureTerrain::getCaveDensities(glm::ivec3(x, 0, z), count, step, scalarDensity.data());
+    ProcedureTerrain::simdNoise = true;
+
+    int mismatches = 0;
+    for (int i = 0; i < n; ++i) {
+        // Bitwise, so NaNs would count too
+        if (std::memcmp(&simdDensity[i], &scalarDensity[i], sizeof(float)) != 0) {
+            ++mismatches;
+        }
+    }
+    std::printf("verify:   %d of %d cave densities differ between %s and scalar noise\n",
+                mismatches, n, ProcedureTerrain::noiseKernelName());
+    return mismatches;
+}
+
+// FNV-1a over every block of the chunks, to compare worlds between runs
+uint32_t blockHash(const std::vector<uPtr<ChunkBlocks>> &chunks) {
+    uint32_t hash = 2166136261u;
+    for (const uPtr<ChunkBlocks> &chunk : chunks) {
+        for (int x = 0; x < 16; ++x) {
+            for (int y = 0; y < 256; ++y) {
+                for (int z = 0; z < 16; ++z) {
+                    hash = (hash ^ chunk->getBlockAt(x, y, z)) * 16777619u;
+                }
+            }
+        }
+    }
+    return hash;
+}
+
+// Generates the chunks of the area once on this thread and once split
+// over several threads at the same time. Returns the number of chunks
+// whose blocks differ.
+int verifyThreads(int x, int z, int size) {
+    const int count = size * size;
+    auto generate = [&](std::vector<uPtr<ChunkBlocks>> &chunks, int first, int step) {
+        for (int i = first; i < count; i += step) {
+            chunks[i] = mkU<ChunkBlocks>();
+            TerrainGenerator::createBlocks(x + 16 * (i / size), z + 16 * (i % size), chunks[i].get());
+        }
+    };
+
+    std::vector<uPtr<ChunkBlocks>> serial(count), parallel(count);
+    generate(serial, 0, 1);
+    const int numThreads = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(generate, std::ref(parallel), t, numThreads);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < count; ++i) {
+        std::vector<uPtr<ChunkBlocks>> a, b;
+        a.push_back(move(serial[i]));
+        b.push_back(move(parallel[i]));
+        mismatches += blockHash(a) != blockHash(b);
+    }
+    std::printf("verify:   %d of %d chunks differ between 1 and %d threads\n",
+                mismatches, count, numThreads);
+    return mismatches;
+}
+
+// Largest height difference --verify accepts between heightSampleStep
+// and sampling every column. Measured worst cases are about step / 2.
+int maxStepError(int step) {
+    return step / 2 + 1;
+}
+
+// Compares the interpolated heightmap of the area with the one sampled at
+// every column. Returns the number of columns off by more than
+// maxStepError.
+int verifyStep(int x, int z, int width) {
+    const int n = width * width;
+    const int step = ProcedureTerrain::heightSampleStep;
+    std::vector<int> coarseHeights(n), coarseGrass(n), fullHeights(n), fullGrass(n);
+
+    ProcedureTerrain::getHeights(x, z, width, width, coarseHeights.data(), coarseGrass.data());
+    ProcedureTerrain::heightSampleStep = 1;
+    ProcedureTerrain::getHeights(x, z, width, width, fullHeights.data(), fullGrass.data());
+    ProcedureTerrain::heightSampleStep = step;
+
+    int failures = 0, maxError = 0, biomeChanges = 0;
+    double totalError = 0.0;
+    for (int i = 0; i < n; ++i) {
+        int error = std::abs(coarseHeights[i] - fullHeights[i]);
+        maxError = std::max(maxError, error);
+        totalError += error;
+        biomeChanges += coarseGrass[i] != fullGrass[i];
+        if (error > maxStepError(step)) {
+            if (failures < 10) {
+                std::fprintf(stderr, "column (%d, %d): height %d with step %d, %d with step 1\n",
+                             x + i / width, z + i % width, coarseHeights[i], step, fullHeights[i]);
+            }
+            ++failures;
+        }
+    }
+    std::printf("step %d:   height error mean %.2f max %d (limit %d), %d of %d biomes differ\n",
+                step, totalError / n, maxError, maxStepError(step), biomeChanges, n);
+    return failures;
+}
+
+// Compares the heightmap of the area from the SIMD and the scalar noise
+// kernels. Returns the number of columns that differ.
+int verifyHeights(int x, int z, int width) {
+    const int n = width * width;
+    std::vector<int> simdHeights(n), simdGrass(n), scalarHeights(n), scalarGrass(n);
+
+    ProcedureTerrain::simdNoise = true;
+    ProcedureTerrain::getHeights(x, z, width, width, simdHeights.data(), simdGrass.data());
+    ProcedureTerrain::simdNoise = false;
+    ProcedureTerrain::getHeights(x, z, width, width, scalarHeights.data(), scalarGrass.data());
+    ProcedureTerrain::simdNoise = true;
+
+    int mismatches = 0;
+    for (int i = 0; i < n; ++i) {
+        if (simdHeights[i] != scalarHeights[i] || simdGrass[i] != scalarGrass[i]) {
+            if (mismatches < 10) {
+                std::fprintf(stderr, "column (%d, %d): %s height %d, scalar height %d\n",
+                             x + i / width, z + i % width, ProcedureTerrain::noiseKernelName(),
+                             simdHeights[i], scalarHeights[i]);
+            }
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+// Saves the chunks to a world in dir, digging a shaft and placing a
+// pillar in every fourth one, then loads them back (generating those
+// that were not saved) and checks they match. Returns 1 if they do not.
+int benchmarkSave(const std::vector<uPtr<ChunkBlocks>> &chunks, const std::string &dir) {
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+
+    std::vector<uPtr<ChunkBlocks>> edited;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        uPtr<ChunkBlocks> copy = chunks[i]->snapshot();
+        if (i % 4 == 0) {
+            copy->fillBox(glm::ivec3(6, 100, 6), glm::ivec3(8, 255, 8), EMPTY);
+            copy->fillBox(glm::ivec3(2, 150, 2), glm::ivec3(2, 160, 2), WOOD);
+        }
+        edited.push_back(move(copy));
+    }
+
+    WorldSave save(dir);
+    Clock::time_point start = Clock::now();
+    for (const uPtr<ChunkBlocks> &chunk : edited) {
+        save.save(chunk->getChunkPos(), chunk->snapshot());
+    }
+    save.flush();
+    double saveSeconds = secondsSince(start);
+
+    std::vector<uPtr<ChunkBlocks>> loaded;
+    start = Clock::now();
+    for (const uPtr<ChunkBlocks> &chunk : edited) {
+        uPtr<ChunkBlocks> copy = mkU<ChunkBlocks>();
+        glm::ivec2 pos = chunk->getChunkPos();
+        if (!save.load(pos, copy.get())) {
+            TerrainGenerator::createBlocks(pos.x, pos.y, copy.get());
+        }
+        loaded.push_back(move(copy));
+    }
+    double loadSeconds = secondsSince(start);
+
+    std::uintmax_t fileBytes = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        fileBytes += entry.file_size();
+    }
+    int count = static_cast<int>(chunks.size());
+    std::printf("save:     %8.1f ms  %10.1f chunks/s  %.1f KiB on disk (%s)\n",
+                saveSeconds * 1000.0, count / saveSeconds, fileBytes / 1024.0,
+                WorldSave::deltaSaves ? "edits only" : "full chunks");
+    std::printf("load:     %8.1f ms  %10.1f chunks/s\n",
+                loadSeconds * 1000.0, count / loadSeconds);
+    if (blockHash(loaded) != blockHash(edited)) {
+        std::fprintf(stderr, "loaded chunks differ from the saved ones\n");
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int size = 16;
+    int originX = 0, originZ = 0;
+    bool verify = false;
+    const char *saveDir = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--naive") == 0) {
+            ChunkBlocks::greedyMeshing = false;
+        } else if (std::strcmp(argv[i], "--scalar") == 0) {
+            ProcedureTerrain::simdNoise = false;
+        } else if (std::strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            if (!ProcedureTerrain::setNoiseKernel(argv[++i])) {
+                std::fprintf(stderr, "noise kernel %s is not supported here\n", argv[i]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            ProcedureTerrain::heightSampleStep = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            ProcedureTerrain::seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (std::strcmp(argv[i], "--no-caves") == 0) {
+            TerrainGenerator::caves = false;
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (std::strcmp(argv[i], "--origin") == 0 && i + 2 < argc) {
+            originX = std::atoi(argv[++i]);
+            originZ = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            saveDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--delta") == 0) {
+            WorldSave::deltaSaves = true;
+        } else if (argv[i][0] != '-' && std::atoi(argv[i]) > 0) {
+            size = std::atoi(argv[i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const int count = size * size;
+
+    if (verify) {
+        // Every SIMD kernel against the scalar one, then the rest with
+        // the kernel that was chosen
+        const char *chosen = ProcedureTerrain::noiseKernelName();
+        int mismatches = 0;
+        for (const char *kernel : ProcedureTerrain::noiseKernelNames()) {
+            if (std::strcmp(kernel, "scalar") == 0) {
+                continue;
+            }
+            ProcedureTerrain::setNoiseKernel(kernel);
+            int columns = verifyHeights(originX, originZ, size * 16);
+            std::printf("verify:   %d of %d columns differ between %s and scalar noise\n",
+                        columns, count * 256, kernel);
+            mismatches += columns + verifyCaves(originX, originZ, size * 16);
+        }
+        ProcedureTerrain::setNoiseKernel(chosen);
+        mismatches += verifyThreads(originX, originZ, std::min(size, 8));
+        int failures = verifyStep(originX, originZ, size * 16);
+        return mismatches == 0 && failures == 0 ? 0 : 1;
+    }
+
+    // Heightmap of the whole area in one batch
+    std::vector<int> heights(count * 256), grass(count * 256);
+    Clock::time_point start = Clock::now();
+    ProcedureTerrain::getHeights(originX, originZ, size * 16, size * 16, heights.data(), grass.data());
+    double heightSeconds = secondsSince(start);
+
+    std::vector<uPtr<ChunkBlocks>> chunks;
+    chunks.reserve(count);
+
+    // Generation
+    start = Clock::now();
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            int x = originX + 16 * i;
+            int z = originZ + 16 * j;
+            uPtr<ChunkBlocks> chunk = mkU<ChunkBlocks>();
+            chunk->setChunkPos(x, z);
+            TerrainGenerator::createBlocks(x, z, chunk.get());
+            chunks.push_back(move(chunk));
+        }
+    }
+    double generateSeconds = secondsSince(start);
+
+    // Link the chunks like Terrain does, so faces between them are culled
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            ChunkBlocks *chunk = chunks[i * size + j].get();
+            if (i + 1 < size) {
+                chunk->linkNeighbor(chunks[(i + 1) * size + j].get(), XPOS);
+            }
+            if (j + 1 < size) {
+                chunk->linkNeighbor(chunks[i * size + j + 1].get(), ZPOS);
+            }
+        }
+    }
+
+    // Meshing
+    std::size_t quads = 0, vertexBytes = 0;
+    start = Clock::now();
+    for (const uPtr<ChunkBlocks> &chunk : chunks) {
+        ChunkVBOData data = chunk->buildVBOdata();
+        quads += (data.vec_data.size() + data.vec_data_trans.size()) / 4;
+        vertexBytes += (data.vec_data.size() + data.vec_data_trans.size()) * sizeof(glm::uvec2);
+    }
+    double meshSeconds = secondsSince(start);
+
+    // Remeshing after an edit, which rebuilds the section holding the
+    // block; here the topmost section of each chunk
+    start = Clock::now();
+    for (const uPtr<ChunkBlocks> &chunk : chunks) {
+        int minY, maxY;
+        if (chunk->getNonEmptyRange(&minY, &maxY)) {
+            // maxY is one past the highest non-empty block
+            chunk->buildVBOdata(uint16_t(1u << ((maxY - 1) / 16)));
+        }
+    }
+    double editSeconds = secondsSince(start);
+
+    std::size_t blockBytes = 0;
+    for (const uPtr<ChunkBlocks> &chunk : chunks) {
+        blockBytes += chunk->blockMemoryUsage();
+    }
+
+    std::printf("chunks:   %d (%d x %d at %d, %d), %s meshing, %s\n",
+                count, size, size, originX, originZ,
+                ChunkBlocks::greedyMeshing ? "greedy" : "naive",
+                TerrainGenerator::caves ? "caves" : "no caves");
+    std::printf("heights:  %8.1f ms  %10.1f columns/s (%s noise, step %d)\n",
+                heightSeconds * 1000.0, count * 256 / heightSeconds, ProcedureTerrain::noiseKernelName(),
+                ProcedureTerrain::heightSampleStep);
+    std::printf("generate: %8.1f ms  %10.1f chunks/s\n",
+                generateSeconds * 1000.0, count / generateSeconds);
+    std::printf("mesh:     %8.1f ms  %10.1f chunks/s  %12.0f faces/s\n",
+                meshSeconds * 1000.0, count / meshSeconds, quads / meshSeconds);
+    std::printf("edit:     %8.1f us per section remeshed (%.1f us per chunk)\n",
+                editSeconds * 1e6 / count, meshSeconds * 1e6 / count);
+    std::printf("faces:    %zu (%.1f KiB of vertices)\n", quads, vertexBytes / 1024.0);
+    std::printf("blocks:   %.1f KiB, hash %08x (seed %u)\n",
+                blockBytes / 1024.0, blockHash(chunks), ProcedureTerrain::seed);
+    int status = saveDir != nullptr ? benchmarkSave(chunks, saveDir) : 0;
+    std::printf("peak RSS: %.1f MiB\n", peakRSS() / (1024.0 * 1024.0));
+    return status;
+}
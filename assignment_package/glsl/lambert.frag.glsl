@@ -27,6 +27,7 @@ in vec4 fs_Nor;
 in vec4 fs_Col;
 
 in vec2 fs_uv;
+in vec2 fs_tile_uv;
 in float fs_animation;
 
 out vec4 out_Col; // This is the final output color that you will see on your
@@ -43,14 +44,17 @@ const vec3 sun[3] = vec3[](vec3(255, 255, 245) / 255.0,
 
 void main()
 {
+    // Wrap into the face's tile so merged quads repeat it per block
+    vec2 uv = fs_uv + fract(fs_tile_uv) / 16.f;
+
     // Material base color (before shading)
     vec4 diffuseColor;
     if (fs_animation == 1.f) {
         // Animation for WATER and LAVA
         float offset = (u_time % 50 / 50.f) * (1.f / 16.f);
-        diffuseColor = texture(u_texture, vec2(fs_uv.x + offset, fs_uv.y));
+        diffuseColor = texture(u_texture, vec2(uv.x + offset, uv.y));
     } else {
-        diffuseColor = texture(u_texture, fs_uv);
+        diffuseColor = texture(u_texture, uv);
     }
 
     // Direction of sun light
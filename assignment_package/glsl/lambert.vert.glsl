@@ -23,21 +23,24 @@ uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformati
 // Time counter
 uniform int u_time;
 
-in vec4 vs_Pos;             // The array of vertex positions passed to the shader
-
-in vec4 vs_Nor;             // The array of vertex normals passed to the shader
-
-in vec4 vs_Col;             // The array of vertex colors passed to the shader.
+in uvec2 vs_Packed;         // The array of packed chunk vertices passed to the shader.
+                            // See ChunkVBOData in scene/chunkblocks.h for the bit layout.
 
 out vec4 fs_Pos;
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_Col;            // The color of each vertex. This is implicitly passed to the fragment shader.
 
 out vec2 fs_uv;
+out vec2 fs_tile_uv;
 out float fs_animation;
 
 const float PI = 3.14159265359;
 
+// Normal of each face, indexed by the Direction enum in scene/chunkblocks.h
+const vec4 face_normals[6] = vec4[](vec4(1, 0, 0, 0), vec4(-1, 0, 0, 0),
+                                    vec4(0, 1, 0, 0), vec4(0, -1, 0, 0),
+                                    vec4(0, 0, 1, 0), vec4(0, 0, -1, 0));
+
 
 vec4 distort_surface_pos(vec4 ori_pos) {
     vec4 res = ori_pos;
@@ -52,11 +55,37 @@ vec4 distort_surface_norm(vec4 ori_pos) {
     return vec4(-normalize(res), 0);
 }
 
+// In-tile uv in block units, taken from the face-local position so
+// that a quad merged from several faces repeats its tile once per block
+vec2 tile_uv(vec4 pos, vec4 nor) {
+    if (nor.x > 0.5) {
+        return vec2(-pos.z, pos.y);
+    } else if (nor.x < -0.5) {
+        return vec2(pos.z, pos.y);
+    } else if (nor.y > 0.5) {
+        return vec2(pos.x, -pos.z);
+    } else if (nor.y < -0.5) {
+        return vec2(pos.x, pos.z);
+    } else if (nor.z > 0.5) {
+        return vec2(pos.x, pos.y);
+    }
+    return vec2(-pos.x, pos.y);
+}
+
 void main()
 {
-    // Extract uv and animation flag from color
-    fs_uv = vs_Col.xy;
-    fs_animation = vs_Col.z;
+    // Unpack position, normal, animation flag and atlas tile
+    vec4 vs_Pos = vec4(float(vs_Packed.x & 31u),
+                       float((vs_Packed.x >> 5) & 511u),
+                       float((vs_Packed.x >> 14) & 31u),
+                       1.f);
+    vec4 vs_Nor = face_normals[int((vs_Packed.x >> 19) & 7u)];
+    uint tile = vs_Packed.y & 255u;
+
+    // Tile origin in the atlas and in-tile uv
+    fs_uv = vec2(float(tile % 16u), float(tile / 16u)) / 16.f;
+    fs_tile_uv = tile_uv(vs_Pos, vs_Nor);
+    fs_animation = float((vs_Packed.x >> 24) & 1u);
 
     // Distort position for surface of water
     vec4 distort_pos;
@@ -0,0 +1,12 @@
+# Builds terraincore, the terrain benchmark and the world pregenerator,
+# with no Qt modules.
+#   qmake headless.pro && make
+#   ./benchmark/terrainbench 16
+#   ./pregen/worldpregen path/to/world 32
+
+TEMPLATE = subdirs
+
+SUBDIRS += terraincore benchmark pregen
+terraincore.file = terraincore.pro
+benchmark.depends = terraincore
+pregen.depends = terraincore
@@ -0,0 +1,174 @@
+// Generates a square of chunks ahead of time and saves them to a world,
+// so the game reads them back instead of generating them when it starts.
+//
+//   worldpregen dir [size] [--center x z] [--threads n] [--seed n] [--no-caves]
+//
+// dir is the world to write to, the same directory the game opens
+// (MINIMINECRAFT_WORLD, or "world" in its application data directory).
+// size is the width of the square in chunks (default 32), centered on
+// the block column (x, z) given by --center (default the spawn point,
+// 320 320). The chunks are generated with TerrainGenerator::createBlocks
+// on a ThreadPool of --threads workers (default one per hardware
+// thread) and saved in full. Chunks the world already holds are left
+// as they are, so an interrupted run can be started again.
+//
+// A new world takes its seed from --seed (default ProcedureTerrain::seed)
+// and an existing one keeps the seed it was made with.
+
+#include "scene/chunkblocks.h"
+#include "scene/procedureterrain.h"
+#include "scene/terraingenerator.h"
+#include "scene/worldsave.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void usage(const char *program) {
+    std::fprintf(stderr, "usage: %s dir [size] [--center x z] [--threads n] [--seed n] [--no-caves]\n", program);
+}
+
+int floorDiv(int a, int b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+void printProgress(std::size_t done, std::size_t total, double seconds) {
+    double rate = seconds > 0.0 ? done / seconds : 0.0;
+    std::printf("pregen:   %zu of %zu chunks (%.1f%%)  %8.1f chunks/s  ", done, total,
+                total > 0 ? 100.0 * done / total : 100.0, rate);
+    if (rate > 0.0) {
+        std::printf("ETA %.0f s\n", (total - done) / rate);
+    } else {
+        std::printf("ETA unknown\n");
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const char *dir = nullptr;
+    int size = 32;
+    int centerX = 320, centerZ = 320;
+    unsigned int numThreads = 0;
+    bool seedGiven = false;
+    uint32_t seed = ProcedureTerrain::seed;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--center") == 0 && i + 2 < argc) {
+            centerX = std::atoi(argv[++i]);
+            centerZ = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+            seedGiven = true;
+        } else if (std::strcmp(argv[i], "--no-caves") == 0) {
+            TerrainGenerator::caves = false;
+        } else if (argv[i][0] != '-' && dir == nullptr) {
+            dir = argv[i];
+        } else if (argv[i][0] != '-' && std::atoi(argv[i]) > 0) {
+            size = std::atoi(argv[i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (dir == nullptr) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Full chunks, so the game does not have to generate them to load them
+    WorldSave::deltaSaves = false;
+    uPtr<WorldSave> save;
+    try {
+        save = mkU<WorldSave>(dir);
+        uint32_t savedSeed;
+        if (save->readSeed(&savedSeed)) {
+            if (seedGiven && savedSeed != seed) {
+                std::fprintf(stderr, "%s was made with seed %u, not %u\n", dir, savedSeed, seed);
+                return 1;
+            }
+            seed = savedSeed;
+        } else {
+            save->writeSeed(seed);
+        }
+    } catch (const std::runtime_error &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    ProcedureTerrain::seed = seed;
+
+    // The chunks of the square that are not saved yet, nearest to the
+    // center first so a partial run covers the spawn point
+    const int firstX = 16 * (floorDiv(centerX, 16) - size / 2);
+    const int firstZ = 16 * (floorDiv(centerZ, 16) - size / 2);
+    std::vector<glm::ivec2> todo;
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            glm::ivec2 pos(firstX + 16 * i, firstZ + 16 * j);
+            if (!save->hasChunk(pos)) {
+                todo.push_back(pos);
+            }
+        }
+    }
+    const glm::ivec2 center(centerX, centerZ);
+    std::stable_sort(todo.begin(), todo.end(), [&](glm::ivec2 a, glm::ivec2 b) {
+        glm::ivec2 da = a + 8 - center, db = b + 8 - center;
+        return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+    });
+
+    ThreadPool workers(numThreads);
+    std::printf("chunks:   %zu to generate of %d (%d x %d from %d, %d), seed %u, %u threads, %s noise\n",
+                todo.size(), size * size, size, size, firstX, firstZ, seed, workers.size(),
+                ProcedureTerrain::noiseKernelName());
+    std::fflush(stdout);
+
+    // Chunks handed to the workers but not yet written. Bounds how many
+    // generated chunks wait in memory when the disk is the slower side.
+    const std::size_t maxInFlight = 64 * workers.size();
+    std::size_t submitted = 0, written = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastReport = start;
+    while (written < todo.size()) {
+        while (submitted < todo.size() && submitted - written < maxInFlight) {
+            glm::ivec2 pos = todo[submitted++];
+            WorldSave *target = save.get();
+            workers.submit(0, [pos, target]() {
+                uPtr<ChunkBlocks> chunk = mkU<ChunkBlocks>();
+                chunk->setChunkPos(pos.x, pos.y);
+                TerrainGenerator::createBlocks(pos.x, pos.y, chunk.get());
+                target->save(pos, move(chunk));
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        written = static_cast<std::size_t>(save->stats().chunksWritten);
+        if (secondsSince(lastReport) >= 1.0) {
+            printProgress(written, todo.size(), secondsSince(start));
+            lastReport = Clock::now();
+        }
+    }
+    save->flush();
+    double seconds = secondsSince(start);
+    printProgress(todo.size(), todo.size(), seconds);
+
+    WorldSave::Stats stats = save->stats();
+    std::printf("done:     %8.1f s  %.1f KiB written to %s\n",
+                seconds, stats.bytesWritten / 1024.0, dir);
+    return 0;
+}
@@ -0,0 +1,32 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/scene/blockstorage.cpp \
+    $$PWD/scene/chunkblocks.cpp \
+    $$PWD/scene/noise_avx2.cpp \
+    $$PWD/scene/noise_sse41.cpp \
+    $$PWD/scene/procedure_terrain.cpp \
+    $$PWD/scene/regionfile.cpp \
+    $$PWD/scene/terraingenerator.cpp \
+    $$PWD/scene/worldsave.cpp \
+    $$PWD/threadpool.cpp
+
+HEADERS += \
+    $$PWD/glm_includes.h \
+    $$PWD/smartpointerhelp.h \
+    $$PWD/scene/blocktype.h \
+    $$PWD/scene/blockregistry.h \
+    $$PWD/scene/blockstorage.h \
+    $$PWD/scene/chunkblocks.h \
+    $$PWD/scene/noisekernels.h \
+    $$PWD/scene/procedureterrain.h \
+    $$PWD/scene/regionfile.h \
+    $$PWD/scene/terraingenerator.h \
+    $$PWD/scene/worldsave.h \
+    $$PWD/threadpool.h
+
+# Every noise kernel must round exactly like the scalar one
+*-clang*|*-g++* {
+    QMAKE_CXXFLAGS += -ffp-contract=off
+}
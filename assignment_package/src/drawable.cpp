@@ -2,8 +2,11 @@
 #include <glm_includes.h>
 
 Drawable::Drawable(OpenGLContext* context)
-    : m_count(-1), m_bufIdx(), m_bufPos(), m_bufNor(), m_bufCol(), m_bufUV(),
-      m_idxGenerated(false), m_posGenerated(false), m_norGenerated(false), m_colGenerated(false), m_UVGenerated(),
+    : m_count(-1), m_count_transparent(-1), m_bufIdx(), m_bufPos(),
+      m_buf_idx_transparent(), m_buf_data_transparent(), m_bufNor(), m_bufCol(), m_bufUV(),
+      m_idxGenerated(false), m_posGenerated(false),
+      m_idx_generated_transparent(false), m_data_generated_transparent(false),
+      m_norGenerated(false), m_colGenerated(false), m_UVGenerated(false),
       mp_context(context)
 {}
 
@@ -13,15 +16,17 @@ Drawable::~Drawable()
 
 void Drawable::destroyVBOdata()
 {
-    mp_context->glDeleteBuffers(1, &m_bufIdx);
-    mp_context->glDeleteBuffers(1, &m_bufPos);
-    mp_context->glDeleteBuffers(1, &m_bufNor);
-    mp_context->glDeleteBuffers(1, &m_bufCol);
+    // Only delete buffers we generated, so that a stale handle
+    // never frees a buffer that now belongs to someone else
+    if (m_idxGenerated) mp_context->glDeleteBuffers(1, &m_bufIdx);
+    if (m_posGenerated) mp_context->glDeleteBuffers(1, &m_bufPos);
+    if (m_norGenerated) mp_context->glDeleteBuffers(1, &m_bufNor);
+    if (m_colGenerated) mp_context->glDeleteBuffers(1, &m_bufCol);
 
-    mp_context->glDeleteBuffers(1, &m_buf_idx_transparent);
-    mp_context->glDeleteBuffers(1, &m_buf_data_transparent);
+    if (m_idx_generated_transparent) mp_context->glDeleteBuffers(1, &m_buf_idx_transparent);
+    if (m_data_generated_transparent) mp_context->glDeleteBuffers(1, &m_buf_data_transparent);
 
-    mp_context->glDeleteBuffers(1, &m_bufUV);
+    if (m_UVGenerated) mp_context->glDeleteBuffers(1, &m_bufUV);
 
     m_idxGenerated = m_posGenerated = m_norGenerated = m_colGenerated = m_idx_generated_transparent = m_data_generated_transparent = m_UVGenerated = false;
     m_count = -1;
@@ -49,6 +54,16 @@ int Drawable::elem_count_transparent()
     return m_count_transparent;
 }
 
+GLenum Drawable::idxType()
+{
+    return GL_UNSIGNED_INT;
+}
+
+GLenum Drawable::idx_type_transparent()
+{
+    return GL_UNSIGNED_INT;
+}
+
 void Drawable::generateIdx()
 {
     m_idxGenerated = true;
@@ -52,6 +52,11 @@ public:
 
     int elem_count_transparent();
 
+    // Type of the indices read by glDrawElements from the buffer
+    // bound by bindIdx() / bind_idx_transparent()
+    virtual GLenum idxType();
+    virtual GLenum idx_type_transparent();
+
     // Call these functions when you want to call glGenBuffers on the buffers stored in the Drawable
     // These will properly set the values of idxBound etc. which need to be checked in ShaderProgram::draw()
     void generateIdx();
@@ -65,12 +70,12 @@ public:
 
     void generateUV();
 
-    bool bindIdx();
+    virtual bool bindIdx();
     bool bindPos();
 
     bool bindUV();
 
-    bool bind_idx_transparent();
+    virtual bool bind_idx_transparent();
     bool bind_data_transparent();
 
     bool bindNor();
@@ -0,0 +1,84 @@
+#include "framescheduler.h"
+#include <chrono>
+
+FrameScheduler::FrameScheduler(double budgetMs, std::size_t budgetBytes)
+    : m_queues(), m_pendingKeys(), m_budgetMs(budgetMs), m_budgetBytes(budgetBytes),
+      m_lastTaskCount(0), m_lastMs(0.0), m_lastBytes(0)
+{}
+
+void FrameScheduler::setBudget(double budgetMs, std::size_t budgetBytes) {
+    m_budgetMs = budgetMs;
+    m_budgetBytes = budgetBytes;
+}
+
+void FrameScheduler::post(Kind kind, std::function<void()> fn, std::size_t bytes) {
+    m_queues[kind].push_back(Task{std::move(fn), bytes, false, 0});
+}
+
+void FrameScheduler::postUnique(Kind kind, int64_t key, std::function<void()> fn, std::size_t bytes) {
+    if (!m_pendingKeys[kind].insert(key).second) {
+        return;
+    }
+    m_queues[kind].push_back(Task{std::move(fn), bytes, true, key});
+}
+
+void FrameScheduler::runFrame() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    int count = 0;
+    std::size_t bytes = 0;
+    double ms = 0.0;
+
+    bool spent = false;
+    for (int k = 0; k < KIND_COUNT && !spent; k++) {
+        std::deque<Task> &queue = m_queues[k];
+        while (!queue.empty()) {
+            // Stop once this task would go over either budget,
+            // unless nothing has run yet this frame
+            if (count > 0 && (ms >= m_budgetMs || bytes + queue.front().bytes > m_budgetBytes)) {
+                spent = true;
+                break;
+            }
+
+            // Pop first, the task may post more work
+            Task task = std::move(queue.front());
+            queue.pop_front();
+            if (task.unique) {
+                m_pendingKeys[k].erase(task.key);
+            }
+            task.fn();
+
+            count++;
+            bytes += task.bytes;
+            ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+    }
+
+    m_lastTaskCount = count;
+    m_lastMs = ms;
+    m_lastBytes = bytes;
+}
+
+int FrameScheduler::pending() const {
+    int total = 0;
+    for (const auto &queue : m_queues) {
+        total += static_cast<int>(queue.size());
+    }
+    return total;
+}
+
+int FrameScheduler::pending(Kind kind) const {
+    return static_cast<int>(m_queues[kind].size());
+}
+
+int FrameScheduler::lastTaskCount() const {
+    return m_lastTaskCount;
+}
+
+double FrameScheduler::lastMs() const {
+    return m_lastMs;
+}
+
+std::size_t FrameScheduler::lastBytes() const {
+    return m_lastBytes;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_set>
+
+// Queues main-thread work (anything that needs the GL context or the GUI)
+// and runs it a frame's worth at a time. runFrame() executes tasks in
+// order of their Kind until either the time budget or the upload byte
+// budget is used up; whatever is left waits for the next frame, so a
+// burst of finished chunks is spread over several frames instead of
+// causing one long hitch.
+class FrameScheduler {
+public:
+    // Tasks of a lower Kind always run before tasks of a higher one
+    enum Kind : int {
+        EDIT_REMESH = 0, // Uploading the sections of a chunk the player just changed
+        GUI_UPDATE,      // Refreshing the player info window
+        VBO_UPLOAD,      // Uploading a freshly meshed chunk
+        KIND_COUNT
+    };
+
+    static constexpr double DEFAULT_BUDGET_MS = 3.0;
+    static constexpr std::size_t DEFAULT_BUDGET_BYTES = 4 * 1024 * 1024;
+
+    FrameScheduler(double budgetMs = DEFAULT_BUDGET_MS,
+                   std::size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    void setBudget(double budgetMs, std::size_t budgetBytes);
+
+    // Queues fn. bytes is how much data it sends to the GPU, if any.
+    void post(Kind kind, std::function<void()> fn, std::size_t bytes = 0);
+    // Like post(), but does nothing if a task of the same kind and key
+    // is still waiting. Use it for tasks that read the latest state when
+    // they run, e.g. remeshing a chunk, so repeated requests collapse.
+    void postUnique(Kind kind, int64_t key, std::function<void()> fn, std::size_t bytes = 0);
+
+    // Runs queued tasks until the frame's budget is spent. At least one
+    // task runs per call so a task larger than the budget still goes.
+    void runFrame();
+
+    // Number of tasks waiting, in total or of one kind
+    int pending() const;
+    int pending(Kind kind) const;
+
+    // What the last runFrame() did
+    int lastTaskCount() const;
+    double lastMs() const;
+    std::size_t lastBytes() const;
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        std::size_t bytes;
+        bool unique;
+        int64_t key;
+    };
+
+    std::array<std::deque<Task>, KIND_COUNT> m_queues;
+    std::array<std::unordered_set<int64_t>, KIND_COUNT> m_pendingKeys;
+
+    double m_budgetMs;
+    std::size_t m_budgetBytes;
+
+    int m_lastTaskCount;
+    double m_lastMs;
+    std::size_t m_lastBytes;
+};
@@ -22,6 +22,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerLook(QString)), &playerInfoWindow, SLOT(slot_setLookText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendTerrainChunks(QString)), &playerInfoWindow, SLOT(slot_setChunksDrawnText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendSaveStats(QString)), &playerInfoWindow, SLOT(slot_setSaveText(QString)));
 
     connect(ui->mygl, SIGNAL(sig_inventoryWindow(bool)), this, SLOT(slot_inventoryWindow(bool)));
     connect(ui->mygl, SIGNAL(sig_updateInventory(BlockType, int)), &inventoryWindow, SLOT(slot_updateInventory(BlockType, int)));
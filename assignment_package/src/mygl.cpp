@@ -4,6 +4,8 @@
 #include <iostream>
 #include <QApplication>
 #include <QKeyEvent>
+#include <QStandardPaths>
+#include <stdexcept>
 
 
 MyGL::MyGL(QWidget *parent)
@@ -11,7 +13,8 @@ MyGL::MyGL(QWidget *parent)
       m_worldAxes(this),
       m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_postprog(this), m_prog_sky(this),
       m_quad(this), m_frameBuffer(this, this->width()*this->devicePixelRatio(), this->height()*this->devicePixelRatio(), this->devicePixelRatio()),
-      m_terrain(this), m_player(glm::vec3(320.f, 150.f, 320.f), m_terrain), m_time(0),
+      m_scheduler(), m_terrain(this, &m_scheduler), m_player(glm::vec3(320.f, 150.f, 320.f), m_terrain), m_time(0),
+      m_lastAutosave(QDateTime::currentMSecsSinceEpoch()), m_autosaveChunks(0),
       m_selectedBlockType(GRASS),
       m_inventoryOpened(false),
       m_GRASSPlacable(true), m_DIRTPlaceable(true), m_STONEPlacable(true),
@@ -26,6 +29,18 @@ MyGL::MyGL(QWidget *parent)
 
     setMouseTracking(true); // MyGL will track the mouse's movements even if a mouse button is not pressed
     setCursor(Qt::BlankCursor); // Make the cursor invisible
+
+    // The world is kept between runs, in MINIMINECRAFT_WORLD if it is set.
+    // Chunks pregenerated into it with worldpregen are loaded, not generated.
+    QString worldDir = QString::fromLocal8Bit(qgetenv("MINIMINECRAFT_WORLD"));
+    if (worldDir.isEmpty()) {
+        worldDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/world";
+    }
+    try {
+        m_terrain.openWorld(worldDir.toStdString());
+    } catch (const std::runtime_error &e) {
+        std::cout << e.what() << "; the world will not be saved" << std::endl;
+    }
 }
 
 MyGL::~MyGL()
@@ -142,8 +157,15 @@ void MyGL::tick()
     // Update terrain based on position of player
     m_terrain.expandZone(m_player.mcr_position, prevPlayerPos);
 
+    if (m_currMSecSinceEpoch - m_lastAutosave >= AUTOSAVE_INTERVAL_MS) {
+        m_autosaveChunks = m_terrain.saveDirtyChunks();
+        m_lastAutosave = m_currMSecSinceEpoch;
+    }
+
     update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
-    sendPlayerDataToGUI(); // Updates the info in the secondary window displaying player data
+    // Updates the info in the secondary window displaying player data,
+    // once the frame's more urgent work is done
+    m_scheduler.postUnique(FrameScheduler::GUI_UPDATE, 0, [this]() { sendPlayerDataToGUI(); });
 }
 
 void MyGL::sendPlayerDataToGUI() const
@@ -157,12 +179,23 @@ void MyGL::sendPlayerDataToGUI() const
     glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    emit sig_sendTerrainChunks(QString::fromStdString(std::to_string(m_terrain.chunksDrawn()) + " drawn, " + std::to_string(m_terrain.chunksCulled()) + " culled, " + std::to_string(m_scheduler.pending(FrameScheduler::VBO_UPLOAD)) + " queued"));
+    if (WorldSave *save = m_terrain.worldSave()) {
+        WorldSave::Stats stats = save->stats();
+        emit sig_sendSaveStats(QString::fromStdString(
+            std::to_string(m_autosaveChunks) + " dirty (" + std::to_string(int(m_terrain.lastSnapshotSeconds() * 1e6)) + " us), " +
+            std::to_string(stats.batchChunks) + " written (" + std::to_string(stats.batchBytes / 1024) + " KiB) in " +
+            std::to_string(int(stats.batchSeconds * 1000)) + " ms"));
+    }
 }
 
 // This function is called whenever update() is called.
 // MyGL's constructor links update() to a timer that fires 60 times per second,
 // so paintGL() called at a rate of 60 frames per second.
 void MyGL::paintGL() {
+    // Main-thread work queued since the last frame, within its budget
+    m_scheduler.runFrame();
+
     m_frameBuffer.bindFrameBuffer();
     // Render on the whole framebuffer, complete from the lower left corner to the upper right
     glViewport(0,0,this->width() * this->devicePixelRatio(), this->height() * this->devicePixelRatio());
@@ -222,7 +255,8 @@ void MyGL::renderTerrain() {
     int player_x = 16 * static_cast<int>(glm::floor(m_player.mcr_position.x / 16.f));
     int player_z = 16 * static_cast<int>(glm::floor(m_player.mcr_position.z / 16.f));
     m_terrain.bind_texture();
-    m_terrain.draw(player_x - 160, player_x + 160, player_z - 160, player_z + 160, &m_progLambert);
+    m_terrain.draw(player_x - 160, player_x + 160, player_z - 160, player_z + 160,
+                   m_player.mcr_camera.getViewProj(), &m_progLambert);
 }
 
 
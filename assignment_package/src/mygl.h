@@ -5,6 +5,7 @@
 #include "shaderprogram.h"
 #include "quad.h"
 #include "framebuffer.h"
+#include "framescheduler.h"
 #include "scene/worldaxes.h"
 #include "scene/camera.h"
 #include "scene/terrain.h"
@@ -35,6 +36,7 @@ private:
     Quad m_quad;
     FrameBuffer m_frameBuffer;
 
+    FrameScheduler m_scheduler; // Spreads chunk uploads, edit remeshes and GUI updates over frames. Declared before m_terrain, which posts to it.
     Terrain m_terrain; // All of the Chunks that currently comprise the world.
     Player m_player; // The entity controlled by the user. Contains a camera to display what it sees as well.
     InputBundle m_inputs; // A collection of variables to be updated in keyPressEvent, mouseMoveEvent, mousePressEvent, etc.
@@ -55,6 +57,13 @@ private:
 
     // MM1
     qint64 m_currMSecSinceEpoch;
+
+    // Dirty chunks are saved in the background this often, so little is
+    // lost if the game does not exit cleanly
+    static constexpr qint64 AUTOSAVE_INTERVAL_MS = 10000;
+    qint64 m_lastAutosave;
+    // Chunks queued by the last autosave
+    int m_autosaveChunks;
 public:
     explicit MyGL(QWidget *parent = nullptr);
     ~MyGL();
@@ -103,6 +112,8 @@ signals:
     void sig_sendPlayerLook(QString) const;
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
+    void sig_sendTerrainChunks(QString) const;
+    void sig_sendSaveStats(QString) const;
     void sig_inventoryWindow(bool) const;
     void sig_updateInventory(BlockType blockType, int num) const;
 };
@@ -35,4 +35,9 @@ void PlayerInfo::slot_setChunkText(QString s) {
 void PlayerInfo::slot_setZoneText(QString s) {
     ui->zoneLabel->setText(s);
 }
-
+void PlayerInfo::slot_setChunksDrawnText(QString s) {
+    ui->chunksDrawnLabel->setText(s);
+}
+void PlayerInfo::slot_setSaveText(QString s) {
+    ui->saveLabel->setText(s);
+}
@@ -0,0 +1,83 @@
+#include "quadindexbuffer.h"
+#include <vector>
+#include <algorithm>
+
+QuadIndexBuffer::QuadIndexBuffer(OpenGLContext *context)
+    : mp_context(context), m_bufShort(0), m_bufInt(0), m_quadsShort(0), m_quadsInt(0)
+{}
+
+template <typename T>
+static std::vector<T> quadIndices(int quadCount) {
+    std::vector<T> idx;
+    idx.reserve(quadCount * 6);
+    for (int i = 0; i < quadCount; i++) {
+        T offset = static_cast<T>(i * 4);
+        idx.push_back(offset);
+        idx.push_back(offset + 1);
+        idx.push_back(offset + 2);
+        idx.push_back(offset);
+        idx.push_back(offset + 2);
+        idx.push_back(offset + 3);
+    }
+    return idx;
+}
+
+void QuadIndexBuffer::grow(GLuint *buf, int *capacity, int quadCount, bool shortIndices) {
+    if (quadCount <= *capacity) {
+        return;
+    }
+    // Grow geometrically so a slowly growing mesh does not
+    // cause a re-upload every time
+    int newCapacity = std::max(quadCount, std::max(*capacity * 2, 1024));
+    if (shortIndices) {
+        newCapacity = std::min(newCapacity, MAX_SHORT_QUADS);
+    }
+
+    if (*capacity == 0) {
+        mp_context->glGenBuffers(1, buf);
+    }
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *buf);
+    if (shortIndices) {
+        std::vector<GLushort> idx = quadIndices<GLushort>(newCapacity);
+        mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLushort), idx.data(), GL_STATIC_DRAW);
+    } else {
+        std::vector<GLuint> idx = quadIndices<GLuint>(newCapacity);
+        mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+    }
+    *capacity = newCapacity;
+}
+
+void QuadIndexBuffer::reserve(int quadCount) {
+    if (quadCount <= MAX_SHORT_QUADS) {
+        grow(&m_bufShort, &m_quadsShort, quadCount, true);
+    } else {
+        grow(&m_bufInt, &m_quadsInt, quadCount, false);
+    }
+}
+
+bool QuadIndexBuffer::bind(int quadCount) {
+    if (quadCount <= MAX_SHORT_QUADS) {
+        if (quadCount > m_quadsShort) {
+            return false;
+        }
+        mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufShort);
+    } else {
+        if (quadCount > m_quadsInt) {
+            return false;
+        }
+        mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufInt);
+    }
+    return true;
+}
+
+GLenum QuadIndexBuffer::type(int quadCount) {
+    return quadCount <= MAX_SHORT_QUADS ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void QuadIndexBuffer::destroy() {
+    // Only delete buffers we generated
+    if (m_quadsShort > 0) mp_context->glDeleteBuffers(1, &m_bufShort);
+    if (m_quadsInt > 0) mp_context->glDeleteBuffers(1, &m_bufInt);
+    m_quadsShort = 0;
+    m_quadsInt = 0;
+}
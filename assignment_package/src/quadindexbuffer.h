@@ -0,0 +1,41 @@
+#pragma once
+#include "openglcontext.h"
+
+// An element array buffer holding the index pattern 0, 1, 2, 0, 2, 3,
+// offset by 4 for every quad. Every mesh made of consecutive 4-vertex
+// quads (i.e. every Chunk) draws from this one buffer instead of
+// storing its own copy of the same indices.
+// Meshes with at most 65536 vertices are drawn with GL_UNSIGNED_SHORT
+// indices, larger ones with GL_UNSIGNED_INT. Each of the two buffers
+// is only created and grown once a mesh needs it.
+class QuadIndexBuffer {
+private:
+    OpenGLContext *mp_context;
+
+    GLuint m_bufShort;
+    GLuint m_bufInt;
+
+    // Number of quads each buffer currently holds indices for
+    int m_quadsShort;
+    int m_quadsInt;
+
+    void grow(GLuint *buf, int *capacity, int quadCount, bool shortIndices);
+
+public:
+    // The most quads whose vertices can all be addressed by a GLushort
+    static constexpr int MAX_SHORT_QUADS = 65536 / 4;
+
+    QuadIndexBuffer(OpenGLContext *context);
+
+    // Makes sure a mesh of quadCount quads can be drawn.
+    // Must be called with the GL context current.
+    void reserve(int quadCount);
+    // Binds the buffer used to draw a mesh of quadCount quads
+    // as GL_ELEMENT_ARRAY_BUFFER. Returns false if it has not
+    // been reserved.
+    bool bind(int quadCount);
+    // Index type to pass to glDrawElements for a mesh of quadCount quads
+    static GLenum type(int quadCount);
+    // Deletes both buffers. Must be called with the GL context current.
+    void destroy();
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "blocktype.h"
+#include <array>
+#include <cstdint>
+
+// Everything the game needs to know about a BlockType, in one table
+// indexed by the type. A new block type takes one new row here instead
+// of a case in every switch on BlockType.
+struct BlockInfo {
+    BlockType type;
+    // Atlas tile of each face, in Direction order (XPOS, XNEG, YPOS,
+    // YNEG, ZPOS, ZNEG)
+    std::array<uint8_t, 6> tiles;
+    // Fills its cell: drawn in the opaque pass and hides the faces of
+    // the blocks around it. Other non-EMPTY blocks are drawn in the
+    // transparent pass.
+    bool opaque;
+    // Stops the player and the rays it casts to pick blocks
+    bool solid;
+    // Can be removed by the player
+    bool breakable;
+    // Scrolls its texture and ripples in the shaders
+    bool animated;
+    // Light it gives off, from 0 (none) to 15
+    uint8_t light;
+};
+
+// Index of the atlas tile at the given column and row
+// (counted from the bottom-left of the 16 x 16 texture atlas)
+constexpr uint8_t atlasTile(unsigned int col, unsigned int row) {
+    return static_cast<uint8_t>(row * 16 + col);
+}
+
+// Tiles of a block whose top and bottom differ from its sides
+constexpr std::array<uint8_t, 6> faceTiles(uint8_t side, uint8_t top, uint8_t bottom) {
+    return {side, side, top, bottom, side, side};
+}
+
+constexpr std::array<uint8_t, 6> faceTiles(uint8_t all) {
+    return faceTiles(all, all, all);
+}
+
+// One row per BlockType, in enum order
+inline constexpr std::array<BlockInfo, BLOCK_TYPE_COUNT> BLOCK_INFO = {{
+    //                                                                     opaque solid  break  anim   light
+    // Never drawn; the debug purple tile
+    {EMPTY,   faceTiles(atlasTile(8, 1)),                                  false, false, false, false, 0},
+    {GRASS,   faceTiles(atlasTile(3, 15), atlasTile(8, 13), atlasTile(2, 15)), true, true, true, false, 0},
+    {DIRT,    faceTiles(atlasTile(2, 15)),                                 true,  true,  true,  false, 0},
+    {STONE,   faceTiles(atlasTile(1, 15)),                                 true,  true,  true,  false, 0},
+    {WATER,   faceTiles(atlasTile(13, 3)),                                 false, false, true,  true,  0},
+    {SNOW,    faceTiles(atlasTile(2, 11)),                                 true,  true,  true,  false, 0},
+    {LAVA,    faceTiles(atlasTile(13, 1)),                                 true,  false, true,  true,  15},
+    {BEDROCK, faceTiles(atlasTile(1, 14)),                                 true,  true,  false, false, 0},
+    {WOOD,    faceTiles(atlasTile(4, 14), atlasTile(5, 14), atlasTile(5, 14)), true, true, true, false, 0},
+    {LEAF,    faceTiles(atlasTile(5, 12)),                                 true,  true,  true,  false, 0},
+}};
+
+constexpr bool blockInfoInEnumOrder() {
+    for (int i = 0; i < BLOCK_TYPE_COUNT; i++) {
+        if (BLOCK_INFO[i].type != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(blockInfoInEnumOrder(), "BLOCK_INFO needs one row per BlockType, in enum order");
+
+constexpr const BlockInfo &blockInfo(BlockType t) {
+    return BLOCK_INFO[t];
+}
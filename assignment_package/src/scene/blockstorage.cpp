@@ -0,0 +1,116 @@
+#include "blockstorage.h"
+#include <algorithm>
+
+BlockStorage::BlockStorage(std::size_t size, BlockType fill)
+    : m_palette{fill}, m_words(), m_bits(0), m_size(size)
+{}
+
+void BlockStorage::setIndex(std::size_t i, unsigned int paletteIdx) {
+    std::size_t bit = i * m_bits;
+    uint64_t mask = ((uint64_t(1) << m_bits) - 1) << (bit % 64);
+    uint64_t &word = m_words[bit / 64];
+    word = (word & ~mask) | (uint64_t(paletteIdx) << (bit % 64));
+}
+
+void BlockStorage::resize(unsigned int bits) {
+    std::vector<uint64_t> words((m_size * bits + 63) / 64, 0);
+    std::swap(words, m_words);
+    unsigned int oldBits = m_bits;
+    m_bits = bits;
+    if (oldBits == 0) {
+        // Everything was palette entry 0, which the zeroed words already say
+        return;
+    }
+    for (std::size_t i = 0; i < m_size; i++) {
+        std::size_t bit = i * oldBits;
+        unsigned int idx = static_cast<unsigned int>(words[bit / 64] >> (bit % 64)) & ((1u << oldBits) - 1);
+        setIndex(i, idx);
+    }
+}
+
+unsigned int BlockStorage::paletteIndex(BlockType t) {
+    auto it = std::find(m_palette.begin(), m_palette.end(), t);
+    if (it != m_palette.end()) {
+        return static_cast<unsigned int>(it - m_palette.begin());
+    }
+
+    m_palette.push_back(t);
+    if (m_palette.size() > (std::size_t(1) << m_bits)) {
+        resize(m_bits == 0 ? 1 : m_bits * 2);
+    }
+    return static_cast<unsigned int>(m_palette.size() - 1);
+}
+
+void BlockStorage::set(std::size_t i, BlockType t) {
+    if (m_bits == 0 && m_palette[0] == t) {
+        return;
+    }
+    setIndex(i, paletteIndex(t));
+}
+
+void BlockStorage::fill(BlockType t) {
+    m_palette.assign(1, t);
+    m_words.clear();
+    m_words.shrink_to_fit();
+    m_bits = 0;
+}
+
+void BlockStorage::assign(const BlockType *blocks) {
+    // Palette in order of first appearance
+    int paletteIdx[256];
+    std::fill(paletteIdx, paletteIdx + 256, -1);
+    m_palette.clear();
+    for (std::size_t i = 0; i < m_size; i++) {
+        if (paletteIdx[blocks[i]] < 0) {
+            paletteIdx[blocks[i]] = static_cast<int>(m_palette.size());
+            m_palette.push_back(blocks[i]);
+        }
+    }
+
+    unsigned int bits = 0;
+    while ((std::size_t(1) << bits) < m_palette.size()) {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    m_bits = bits;
+    m_words.assign((m_size * bits + 63) / 64, 0);
+    if (bits == 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < m_size; i++) {
+        std::size_t bit = i * bits;
+        m_words[bit / 64] |= uint64_t(paletteIdx[blocks[i]]) << (bit % 64);
+    }
+}
+
+void BlockStorage::copyTo(BlockType *out) const {
+    if (m_bits == 0) {
+        std::fill(out, out + m_size, m_palette[0]);
+        return;
+    }
+    // Indices never straddle words, so each word unpacks on its own
+    const std::size_t perWord = 64 / m_bits;
+    const uint64_t mask = (uint64_t(1) << m_bits) - 1;
+    std::size_t i = 0;
+    for (uint64_t word : m_words) {
+        for (std::size_t j = 0; j < perWord && i < m_size; j++, i++) {
+            out[i] = m_palette[word & mask];
+            word >>= m_bits;
+        }
+    }
+}
+
+std::size_t BlockStorage::size() const {
+    return m_size;
+}
+
+unsigned int BlockStorage::bitsPerBlock() const {
+    return m_bits;
+}
+
+std::size_t BlockStorage::paletteSize() const {
+    return m_palette.size();
+}
+
+std::size_t BlockStorage::memoryUsage() const {
+    return m_palette.capacity() * sizeof(BlockType) + m_words.capacity() * sizeof(uint64_t);
+}
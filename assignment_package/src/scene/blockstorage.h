@@ -0,0 +1,57 @@
+#pragma once
+#include "blocktype.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stores a fixed number of BlockTypes as indices into a small palette of
+// the types actually present. While there is only one type no indices are
+// stored at all; after that each index takes 1, 2, 4 or 8 bits, packed
+// into 64-bit words, and the width doubles whenever set() adds a type
+// the current width cannot address.
+// Widths are powers of two so that an index never straddles two words.
+class BlockStorage {
+private:
+    std::vector<BlockType> m_palette;
+    std::vector<uint64_t> m_words;
+    unsigned int m_bits;
+    std::size_t m_size;
+
+    // Returns the palette index of t, adding it (and widening the
+    // indices if needed) when it is not in the palette yet
+    unsigned int paletteIndex(BlockType t);
+    void resize(unsigned int bits);
+    unsigned int index(std::size_t i) const;
+    void setIndex(std::size_t i, unsigned int paletteIdx);
+
+public:
+    BlockStorage(std::size_t size, BlockType fill = EMPTY);
+
+    BlockType get(std::size_t i) const;
+    void set(std::size_t i, BlockType t);
+    // Sets every block to t and drops all other palette entries
+    void fill(BlockType t);
+    // Replaces every block with blocks[0] to blocks[size() - 1], packing
+    // them at the narrowest width that fits in one pass
+    void assign(const BlockType *blocks);
+    // Writes every block to out[0] to out[size() - 1]
+    void copyTo(BlockType *out) const;
+
+    std::size_t size() const;
+    unsigned int bitsPerBlock() const;
+    std::size_t paletteSize() const;
+    // Bytes held on the heap by the palette and the packed indices
+    std::size_t memoryUsage() const;
+};
+
+inline unsigned int BlockStorage::index(std::size_t i) const {
+    std::size_t bit = i * m_bits;
+    return static_cast<unsigned int>(m_words[bit / 64] >> (bit % 64)) & ((1u << m_bits) - 1);
+}
+
+inline BlockType BlockStorage::get(std::size_t i) const {
+    if (m_bits == 0) {
+        return m_palette[0];
+    }
+    return m_palette[index(i)];
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// C++ 11 allows us to define the size of an enum. This lets us use only one byte
+// of memory to store our different block types. By default, the size of a C++ enum
+// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
+// block types, but in the scope of this project we'll never get anywhere near that many.
+enum BlockType : unsigned char
+{
+    EMPTY, GRASS, DIRT, STONE, WATER, SNOW, LAVA, BEDROCK, WOOD, LEAF
+};
+
+// Number of BlockTypes. Keep it one past the last one.
+constexpr int BLOCK_TYPE_COUNT = LEAF + 1;
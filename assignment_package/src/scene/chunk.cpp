@@ -2,885 +2,174 @@
 #include <iostream>
 
 
-Chunk::Chunk(OpenGLContext *context)
-    : Drawable(context), m_blocks(), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}}
-{
-    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+Chunk::Chunk(OpenGLContext *context, QuadIndexBuffer *quadIndices)
+    : Drawable(context), ChunkBlocks(),
+      chunkVBOData(), m_meshVersion(0), m_meshJobs(0), m_staleSections(ALL_SECTIONS),
+      m_sectionQuads(), m_sectionQuadsTrans(), mp_quadIndices(quadIndices)
+{}
+
+void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
+    ChunkBlocks::linkNeighbor(neighbor.get(), dir);
 }
 
-// Does bounds checking with at()
-BlockType Chunk::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
-    return m_blocks.at(x + 16 * y + 16 * 256 * z);
+bool Chunk::isInUse() const {
+    return m_meshJobs > 0;
 }
 
-// Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
-BlockType Chunk::getBlockAt(int x, int y, int z) const {
-    return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
+void Chunk::createVBOdata() {
+    // Anything still being meshed on a worker is now out of date
+    requestMesh();
+    chunkVBOData = buildVBOdata();
+    chunkVBOData.chunk = this;
+    chunkVBOData.version = m_meshVersion;
 }
 
-// Does bounds checking with at()
-void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
-    m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+int Chunk::requestMesh(uint16_t sections) {
+    m_staleSections |= sections;
+    return ++m_meshVersion;
 }
 
+int Chunk::meshVersion() const {
+    return m_meshVersion;
+}
 
-const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection {
-    {XPOS, XNEG},
-    {XNEG, XPOS},
-    {YPOS, YNEG},
-    {YNEG, YPOS},
-    {ZPOS, ZNEG},
-    {ZNEG, ZPOS}
-};
+uint16_t Chunk::staleSections() const {
+    return m_staleSections;
+}
 
-void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
-    if(neighbor != nullptr) {
-        this->m_neighbors[dir] = neighbor.get();
-        neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
+bool Chunk::setVBOdata(ChunkVBOData &&data) {
+    if (data.version != m_meshVersion) {
+        return false;
     }
+    chunkVBOData = std::move(data);
+    chunkVBOData.chunk = this;
+    return true;
 }
 
-void Chunk::createVBOdata() {
-    std::vector<GLuint> vec_idx;
-    // Store interleaved data as pos-norm-col
-    std::vector<glm::vec4> vec_data;
-
-    // Store interleaved data for transparent blocks
-    std::vector<GLuint> vec_idx_transparent;
-    std::vector<glm::vec4> vec_data_transparent;
-
-    // Record offset of vertex index for each face
-    int index_offset = 0;
-
-    int index_offset_transparent = 0;
-
-    // Traverse all blocks
-    for (int z = 0; z < 16; z++) {
-        for (int y = 0; y < 256; y++) {
-            for (int x = 0; x < 16; x++) {
-                BlockType t = getBlockAt(x, y, z);
-
-                // Position offset of vertex
-                glm::vec4 block_offset(x, y, z, 0);
-
-                // Offset of uv coords for 4 corners
-                glm::vec2 uv_offset[4] = {glm::vec2(0, 0),
-                                          glm::vec2(1.f / 16.f, 0),
-                                          glm::vec2(1.f / 16.f, 1.f / 16.f),
-                                          glm::vec2(0, 1.f / 16.f)};
-
-                if (t == EMPTY) {
-                    continue;
-                }
-                if (!is_transparent(t)) {
-                    // Check all neighbors for opaque blocks
-
-                    // YPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_y_pos;
-                    if (y == 255) {
-                        // Border case
-                        t_y_pos = EMPTY;
-                    } else {
-                        t_y_pos = getBlockAt(x, y + 1, z);
-                    }
-
-                    if (t_y_pos == EMPTY || is_transparent(t_y_pos)) {
-                        // Ceiling
-                        glm::vec4 ceiling[4] = {glm::vec4(0, 1, 1, 1),
-                                                glm::vec4(1, 1, 1, 1),
-                                                glm::vec4(1, 1, 0, 1),
-                                                glm::vec4(0, 1, 0, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(ceiling[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(0, 1, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 13.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // YNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_y_neg;
-                    if (y == 0) {
-                        // Border case
-                        t_y_neg = EMPTY;
-                    } else {
-                        t_y_neg = getBlockAt(x, y - 1, z);
-                    }
-
-                    if (t_y_neg == EMPTY || is_transparent(t_y_neg)) {
-                        // Floor
-                        glm::vec4 floor[4] = {glm::vec4(0, 0, 0, 1),
-                                              glm::vec4(1, 0, 0, 1),
-                                              glm::vec4(1, 0, 1, 1),
-                                              glm::vec4(0, 0, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(floor[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(0, -1, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // XPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_x_pos;
-                    if (x == 15) {
-                        // Border case
-                        if (m_neighbors[XPOS] == nullptr) {
-                            t_x_pos = EMPTY;
-                        } else {
-                            t_x_pos = m_neighbors[XPOS]->getBlockAt(0, y, z);
-                        }
-                    } else {
-                        t_x_pos = getBlockAt(x + 1, y, z);
-                    }
-
-                    if (t_x_pos == EMPTY || is_transparent(t_x_pos)) {
-                        // Forward
-                        glm::vec4 forward[4] = {glm::vec4(1, 0, 1, 1),
-                                                glm::vec4(1, 0, 0, 1),
-                                                glm::vec4(1, 1, 0, 1),
-                                                glm::vec4(1, 1, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(forward[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(1, 0, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(3.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(4.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // XNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_x_neg;
-                    if (x == 0) {
-                        // Border case
-                        if (m_neighbors[XNEG] == nullptr) {
-                            t_x_neg = EMPTY;
-                        } else {
-                            t_x_neg = m_neighbors[XNEG]->getBlockAt(15, y, z);
-                        }
-                    } else {
-                        t_x_neg = getBlockAt(x - 1, y, z);
-                    }
-
-                    if (t_x_neg == EMPTY || is_transparent(t_x_neg)) {
-                        // Back
-                        glm::vec4 back[4] = {glm::vec4(0, 0, 0, 1),
-                                             glm::vec4(0, 0, 1, 1),
-                                             glm::vec4(0, 1, 1, 1),
-                                             glm::vec4(0, 1, 0, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(back[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(-1, 0, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(3.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(4.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // ZPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_z_pos;
-                    if (z == 15) {
-                        // Border case
-                        if (m_neighbors[ZPOS] == nullptr) {
-                            t_z_pos = EMPTY;
-                        } else {
-                            t_z_pos = m_neighbors[ZPOS]->getBlockAt(x, y, 0);
-                        }
-                    } else {
-                        t_z_pos = getBlockAt(x, y, z + 1);
-                    }
-
-                    if (t_z_pos == EMPTY || is_transparent(t_z_pos)) {
-                        // Right
-                        glm::vec4 right[4] = {glm::vec4(0, 0, 1, 1),
-                                              glm::vec4(1, 0, 1, 1),
-                                              glm::vec4(1, 1, 1, 1),
-                                              glm::vec4(0, 1, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(right[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(0, 0, 1, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(3.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(4.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // ZNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_z_neg;
-                    if (z == 0) {
-                        // Border case
-                        if (m_neighbors[ZNEG] == nullptr) {
-                            t_z_neg = EMPTY;
-                        } else {
-                            t_z_neg = m_neighbors[ZNEG]->getBlockAt(x, y, 15);
-                        }
-                    } else {
-                        t_z_neg = getBlockAt(x, y, z - 1);
-                    }
-
-                    if (t_z_neg == EMPTY || is_transparent(t_z_neg)) {
-                        // Left
-                        glm::vec4 left[4] = {glm::vec4(1, 0, 0, 1),
-                                             glm::vec4(0, 0, 0, 1),
-                                             glm::vec4(0, 1, 0, 1),
-                                             glm::vec4(1, 1, 0, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data.push_back(left[i] + block_offset);
-                            // Normal
-                            vec_data.push_back(glm::vec4(0, 0, -1, 0));
-
-                            // UV
-                            switch(t) {
-                                case GRASS:
-                                    vec_data.push_back(glm::vec4(glm::vec2(3.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case DIRT:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case STONE:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 15.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case WOOD:
-                                    vec_data.push_back(glm::vec4(glm::vec2(4.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LEAF:
-                                    vec_data.push_back(glm::vec4(glm::vec2(5.f / 16.f, 12.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case LAVA:
-                                    vec_data.push_back(glm::vec4(glm::vec2(13.f / 16.f, 1.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                case BEDROCK:
-                                    vec_data.push_back(glm::vec4(glm::vec2(1.f / 16.f, 14.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                case SNOW:
-                                    vec_data.push_back(glm::vec4(glm::vec2(2.f / 16.f, 11.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 1);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset);
-                        vec_idx.push_back(index_offset + 2);
-                        vec_idx.push_back(index_offset + 3);
-
-                        index_offset += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-                } else {
-                    // Check all neighbors for transparent blocks
-
-                    // YPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_y_pos;
-                    if (y == 255) {
-                        // Border case
-                        t_y_pos = EMPTY;
-                    } else {
-                        t_y_pos = getBlockAt(x, y + 1, z);
-                    }
-
-                    if (t_y_pos == EMPTY) {
-                        // Ceiling
-                        glm::vec4 ceiling[4] = {glm::vec4(0, 1, 1, 1),
-                                                glm::vec4(1, 1, 1, 1),
-                                                glm::vec4(1, 1, 0, 1),
-                                                glm::vec4(0, 1, 0, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(ceiling[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(0, 1, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
-
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // YNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_y_neg;
-                    if (y == 0) {
-                        // Border case
-                        t_y_neg = EMPTY;
-                    } else {
-                        t_y_neg = getBlockAt(x, y - 1, z);
-                    }
-
-                    if (t_y_neg == EMPTY) {
-                        // Floor
-                        glm::vec4 floor[4] = {glm::vec4(0, 0, 0, 1),
-                                              glm::vec4(1, 0, 0, 1),
-                                              glm::vec4(1, 0, 1, 1),
-                                              glm::vec4(0, 0, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(floor[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(0, -1, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
-
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // XPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_x_pos;
-                    if (x == 15) {
-                        // Border case
-                        if (m_neighbors[XPOS] == nullptr) {
-                            t_x_pos = BEDROCK;
-                        } else {
-                            t_x_pos = m_neighbors[XPOS]->getBlockAt(0, y, z);
-                        }
-                    } else {
-                        t_x_pos = getBlockAt(x + 1, y, z);
-                    }
-
-                    if (t_x_pos == EMPTY) {
-                        // Forward
-                        glm::vec4 forward[4] = {glm::vec4(1, 0, 1, 1),
-                                                glm::vec4(1, 0, 0, 1),
-                                                glm::vec4(1, 1, 0, 1),
-                                                glm::vec4(1, 1, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(forward[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(1, 0, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
-
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // XNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_x_neg;
-                    if (x == 0) {
-                        // Border case
-                        if (m_neighbors[XNEG] == nullptr) {
-                            t_x_neg = BEDROCK;
-                        } else {
-                            t_x_neg = m_neighbors[XNEG]->getBlockAt(15, y, z);
-                        }
-                    } else {
-                        t_x_neg = getBlockAt(x - 1, y, z);
-                    }
-
-                    if (t_x_neg == EMPTY) {
-                        // Back
-                        glm::vec4 back[4] = {glm::vec4(0, 0, 0, 1),
-                                             glm::vec4(0, 0, 1, 1),
-                                             glm::vec4(0, 1, 1, 1),
-                                             glm::vec4(0, 1, 0, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(back[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(-1, 0, 0, 0));
-
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
-
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // ZPOS
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_z_pos;
-                    if (z == 15) {
-                        // Border case
-                        if (m_neighbors[ZPOS] == nullptr) {
-                            t_z_pos = BEDROCK;
-                        } else {
-                            t_z_pos = m_neighbors[ZPOS]->getBlockAt(x, y, 0);
-                        }
-                    } else {
-                        t_z_pos = getBlockAt(x, y, z + 1);
-                    }
-
-                    if (t_z_pos == EMPTY) {
-                        // Right
-                        glm::vec4 right[4] = {glm::vec4(0, 0, 1, 1),
-                                              glm::vec4(1, 0, 1, 1),
-                                              glm::vec4(1, 1, 1, 1),
-                                              glm::vec4(0, 1, 1, 1)};
-
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(right[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(0, 0, 1, 0));
-
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
-
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
-
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-
-                    // ZNEG
-                    //////////////////////////////////////////////////////////////////
-                    BlockType t_z_neg;
-                    if (z == 0) {
-                        // Border case
-                        if (m_neighbors[ZNEG] == nullptr) {
-                            t_z_neg = BEDROCK;
-                        } else {
-                            t_z_neg = m_neighbors[ZNEG]->getBlockAt(x, y, 15);
-                        }
-                    } else {
-                        t_z_neg = getBlockAt(x, y, z - 1);
-                    }
+void Chunk::beginMeshJob() {
+    m_meshJobs++;
+}
 
-                    if (t_z_neg == EMPTY) {
-                        // Left
-                        glm::vec4 left[4] = {glm::vec4(1, 0, 0, 1),
-                                             glm::vec4(0, 0, 0, 1),
-                                             glm::vec4(0, 1, 0, 1),
-                                             glm::vec4(1, 1, 0, 1)};
+void Chunk::endMeshJob() {
+    m_meshJobs--;
+}
 
-                        for (int i = 0; i < 4; i++) {
-                            // Position
-                            vec_data_transparent.push_back(left[i] + block_offset);
-                            // Normal
-                            vec_data_transparent.push_back(glm::vec4(0, 0, -1, 0));
+bool Chunk::hasVBO() {
+    return elemCount() >= 0;
+}
 
-                            // UV
-                            switch(t) {
-                                case WATER:
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(13.f / 16.f, 3.f / 16.f) + uv_offset[i], 1, 1));
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    vec_data_transparent.push_back(glm::vec4(glm::vec2(8.f / 16.f, 1.f / 16.f) + uv_offset[i], 0, 1));
-                                    break;
-                            }
-                        }
+std::size_t Chunk::memoryUsage() {
+    std::size_t bytes = sizeof(Chunk) + blockMemoryUsage();
+    // A mesh waiting for sendVBO()
+    bytes += (chunkVBOData.vec_data.capacity() + chunkVBOData.vec_data_trans.capacity()) * sizeof(glm::uvec2);
+    // Four vertices per six indices on the GPU
+    if (hasVBO()) {
+        bytes += (elemCount() + elem_count_transparent()) / 6 * 4 * sizeof(glm::uvec2);
+    }
+    return bytes;
+}
 
-                        // Index
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 1);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent);
-                        vec_idx_transparent.push_back(index_offset_transparent + 2);
-                        vec_idx_transparent.push_back(index_offset_transparent + 3);
+void Chunk::replaceSections(GLuint *buffer, std::array<uint32_t, 16> *layout,
+                            const std::vector<glm::uvec2> &data,
+                            const std::array<uint32_t, 16> &dataQuads, uint16_t sections) {
+    const std::size_t quadBytes = 4 * sizeof(glm::uvec2);
+    std::array<uint32_t, 16> newLayout;
+    std::size_t total = 0;
+    for (int s = 0; s < 16; s++) {
+        newLayout[s] = (sections >> s & 1) ? dataQuads[s] : (*layout)[s];
+        total += newLayout[s];
+    }
 
-                        index_offset_transparent += 4;
-                    }
-                    //////////////////////////////////////////////////////////////////
-                }
+    GLuint fresh;
+    mp_context->glGenBuffers(1, &fresh);
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, fresh);
+    mp_context->glBufferData(GL_COPY_WRITE_BUFFER, total * quadBytes, nullptr, GL_STATIC_DRAW);
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+
+    std::size_t oldQuad = 0, newQuad = 0, dataQuad = 0;
+    for (int s = 0; s < 16; s++) {
+        if (sections >> s & 1) {
+            if (newLayout[s] > 0) {
+                mp_context->glBufferSubData(GL_COPY_WRITE_BUFFER, newQuad * quadBytes, newLayout[s] * quadBytes,
+                                            data.data() + dataQuad * 4);
             }
+            dataQuad += newLayout[s];
+        } else if (newLayout[s] > 0) {
+            mp_context->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                            oldQuad * quadBytes, newQuad * quadBytes, newLayout[s] * quadBytes);
         }
+        oldQuad += (*layout)[s];
+        newQuad += newLayout[s];
     }
 
-    // MM2
-    chunkVBOData.vec_data = vec_data;
-    chunkVBOData.vec_data_trans = vec_data_transparent;
-
-    chunkVBOData.vec_id = vec_idx;
-    chunkVBOData.vec_id_trans = vec_idx_transparent;
+    mp_context->glDeleteBuffers(1, buffer);
+    *buffer = fresh;
+    *layout = newLayout;
 }
+
 void Chunk::sendVBO()
 {
     // send data to GPU
-    // Set counter for indices buffer
-    m_count = chunkVBOData.vec_id.size();
-    m_count_transparent = chunkVBOData.vec_id_trans.size();
-
-    // Send index data to VBO
-    generateIdx();
-    bindIdx();
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, chunkVBOData.vec_id.size() * sizeof(GLuint), chunkVBOData.vec_id.data(), GL_STATIC_DRAW);
-
-    generate_idx_transparent();
-    bind_idx_transparent();
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, chunkVBOData.vec_id_trans.size() * sizeof(GLuint), chunkVBOData.vec_id_trans.data(), GL_STATIC_DRAW);
-
-    // Send position/color data to VBO
-    generatePos();
-    bindPos();
-    mp_context->glBufferData(GL_ARRAY_BUFFER, chunkVBOData.vec_data.size() * sizeof(glm::vec4), chunkVBOData.vec_data.data(), GL_STATIC_DRAW);
+    if (chunkVBOData.sections == ALL_SECTIONS || !hasVBO()) {
+        // Replaces the buffers of any older mesh
+        destroyVBOdata();
+
+        // Send packed vertex data to VBO
+        generatePos();
+        bindPos();
+        mp_context->glBufferData(GL_ARRAY_BUFFER, chunkVBOData.vec_data.size() * sizeof(glm::uvec2), chunkVBOData.vec_data.data(), GL_STATIC_DRAW);
+
+        generate_data_transparent();
+        bind_data_transparent();
+        mp_context->glBufferData(GL_ARRAY_BUFFER, chunkVBOData.vec_data_trans.size() * sizeof(glm::uvec2), chunkVBOData.vec_data_trans.data(), GL_STATIC_DRAW);
+
+        m_sectionQuads = chunkVBOData.sectionQuads;
+        m_sectionQuadsTrans = chunkVBOData.sectionQuadsTrans;
+    } else {
+        // Only the edited sections changed. The new buffers are complete
+        // before they replace the old ones, so no frame draws half a mesh.
+        replaceSections(&m_bufPos, &m_sectionQuads, chunkVBOData.vec_data,
+                        chunkVBOData.sectionQuads, chunkVBOData.sections);
+        replaceSections(&m_buf_data_transparent, &m_sectionQuadsTrans, chunkVBOData.vec_data_trans,
+                        chunkVBOData.sectionQuadsTrans, chunkVBOData.sections);
+    }
+    m_staleSections = 0;
+    // The GPU has its own copy now
+    chunkVBOData = ChunkVBOData();
+
+    // Set counter for indices, six per quad of four vertices
+    int quads = 0, quadsTrans = 0;
+    for (int s = 0; s < 16; s++) {
+        quads += m_sectionQuads[s];
+        quadsTrans += m_sectionQuadsTrans[s];
+    }
+    m_count = quads * 6;
+    m_count_transparent = quadsTrans * 6;
 
-    generate_data_transparent();
-    bind_data_transparent();
-    mp_context->glBufferData(GL_ARRAY_BUFFER, chunkVBOData.vec_data_trans.size() * sizeof(glm::vec4), chunkVBOData.vec_data_trans.data(), GL_STATIC_DRAW);
+    // Make sure the shared index buffer covers both meshes
+    mp_quadIndices->reserve(quads);
+    mp_quadIndices->reserve(quadsTrans);
 }
 
-void Chunk::clear_VBO_data() {
-    chunkVBOData.vec_data.clear();
-    chunkVBOData.vec_data_trans.clear();
-
-    chunkVBOData.vec_id.clear();
-    chunkVBOData.vec_id_trans.clear();
-
-    destroyVBOdata();
+bool Chunk::bindIdx() {
+    return mp_quadIndices->bind(m_count / 6);
 }
 
-void Chunk::update_neighbor_chunks() {
-    // Check 4 horizontal neighbors
-    if (m_neighbors[XPOS] != nullptr) {
-        m_neighbors[XPOS]->destroyVBOdata();
-        m_neighbors[XPOS]->createVBOdata();
-        m_neighbors[XPOS]->sendVBO();
-    }
-    if (m_neighbors[XNEG] != nullptr) {
-        m_neighbors[XNEG]->destroyVBOdata();
-        m_neighbors[XNEG]->createVBOdata();
-        m_neighbors[XNEG]->sendVBO();
-    }
-    if (m_neighbors[ZPOS] != nullptr) {
-        m_neighbors[ZPOS]->destroyVBOdata();
-        m_neighbors[ZPOS]->createVBOdata();
-        m_neighbors[ZPOS]->sendVBO();
-    }
-    if (m_neighbors[ZNEG] != nullptr) {
-        m_neighbors[ZNEG]->destroyVBOdata();
-        m_neighbors[ZNEG]->createVBOdata();
-        m_neighbors[ZNEG]->sendVBO();
-    }
+bool Chunk::bind_idx_transparent() {
+    return mp_quadIndices->bind(m_count_transparent / 6);
 }
 
-bool Chunk::is_transparent(BlockType t) {
-    return t == WATER;
+GLenum Chunk::idxType() {
+    return QuadIndexBuffer::type(m_count / 6);
 }
 
-void Chunk::setChunkPos(int x, int z)
-{
-    int x_floor = static_cast<int>(glm::floor(x / 16.f));
-    int z_floor = static_cast<int>(glm::floor(z / 16.f));
-    chunkPos = glm::ivec2(16 * x_floor, 16 * z_floor);
+GLenum Chunk::idx_type_transparent() {
+    return QuadIndexBuffer::type(m_count_transparent / 6);
 }
-glm::ivec2 Chunk::getChunkPos()
-{
-    return chunkPos;
+
+void Chunk::clear_VBO_data() {
+    chunkVBOData = ChunkVBOData();
+
+    destroyVBOdata();
+    m_staleSections = ALL_SECTIONS;
 }
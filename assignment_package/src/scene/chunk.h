@@ -2,46 +2,14 @@
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
 #include "drawable.h"
+#include "quadindexbuffer.h"
+#include "chunkblocks.h"
 #include <array>
-#include <unordered_map>
 #include <cstddef>
 
 
 //using namespace std;
 
-// C++ 11 allows us to define the size of an enum. This lets us use only one byte
-// of memory to store our different block types. By default, the size of a C++ enum
-// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
-// block types, but in the scope of this project we'll never get anywhere near that many.
-enum BlockType : unsigned char
-{
-    EMPTY, GRASS, DIRT, STONE, WATER, SNOW, LAVA, BEDROCK, WOOD, LEAF
-};
-
-// The six cardinal directions in 3D space
-enum Direction : unsigned char
-{
-    XPOS, XNEG, YPOS, YNEG, ZPOS, ZNEG
-};
-
-// Lets us use any enum class as the key of a
-// std::unordered_map
-struct EnumHash {
-    template <typename T>
-    size_t operator()(T t) const {
-        return static_cast<size_t>(t);
-    }
-};
-
-// MM2
-class Chunk;
-struct ChunkVBOData
-{
-    Chunk* chunk;
-    std::vector<glm::vec4> vec_data, vec_data_trans;
-    std::vector<GLuint> vec_id, vec_id_trans;
-};
-
 // One Chunk is a 16 x 256 x 16 section of the world,
 // containing all the Minecraft blocks in that area.
 // We divide the world into Chunks in order to make
@@ -50,40 +18,70 @@ struct ChunkVBOData
 // to render the world block by block.
 
 // Have Chunk inherit from Drawable
-class Chunk : public Drawable {
+class Chunk : public Drawable, public ChunkBlocks {
 private:
-    // All of the blocks contained within this Chunk
-    std::array<BlockType, 65536> m_blocks;
-    // This Chunk's four neighbors to the north, south, east, and west
-    // The third input to this map just lets us use a Direction as
-    // a key for this map.
-    // These allow us to properly determine
-    std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors;
-
-    // MM2
-    glm::ivec2 chunkPos;
+    // The mesh to upload; empty once sendVBO() has uploaded it
     ChunkVBOData chunkVBOData;
-  
+    // Bumped every time a new mesh is requested, so a mesh
+    // built on a worker thread that has since gone stale
+    // (e.g. the player edited the chunk) is never uploaded
+    int m_meshVersion;
+    // Number of worker meshes of this Chunk not yet uploaded or
+    // discarded. Only touched on the main thread.
+    int m_meshJobs;
+    // Sections whose uploaded quads are out of date, i.e. that the
+    // next mesh has to rebuild. Every section until the first upload.
+    uint16_t m_staleSections;
+    // Quads of each section in the opaque and transparent vertex
+    // buffers, in the order they are stored there
+    std::array<uint32_t, 16> m_sectionQuads, m_sectionQuadsTrans;
+
+    // Index buffer shared by all chunks
+    QuadIndexBuffer *mp_quadIndices;
+
+    // Rebuilds a vertex buffer laid out by layout with the sections of
+    // the mesh replaced by its quads. The other sections are copied
+    // from the old buffer on the GPU, which is then freed.
+    void replaceSections(GLuint *buffer, std::array<uint32_t, 16> *layout,
+                         const std::vector<glm::uvec2> &data,
+                         const std::array<uint32_t, 16> &dataQuads, uint16_t sections);
+
 public:
-    Chunk(OpenGLContext *context);
-    BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
-    BlockType getBlockAt(int x, int y, int z) const;
-    void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+    Chunk(OpenGLContext *context, QuadIndexBuffer *quadIndices);
     void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
+    // Is a worker mesh of this Chunk still in flight? Meshes of its
+    // neighbors read a snapshot of its border, not the Chunk.
+    bool isInUse() const;
 
     // Creates VBO data for only visible block faces
     void createVBOdata() override;
+    // Marks the sections in the mask stale and starts a new mesh
+    // request, which has to rebuild staleSections(). Returns its version.
+    int requestMesh(uint16_t sections = ALL_SECTIONS);
+    int meshVersion() const;
+    uint16_t staleSections() const;
+    // Takes a mesh built by buildVBOdata() on a worker thread as the
+    // CPU-side VBO data. Returns false and leaves data alone if the mesh
+    // is stale.
+    bool setVBOdata(ChunkVBOData &&data);
+    // Bracket a worker mesh of this Chunk, from request until its
+    // result is uploaded or thrown away
+    void beginMeshJob();
+    void endMeshJob();
+    // Has sendVBO() been called since the last clear_VBO_data()?
+    bool hasVBO();
+    // Approximate bytes held by this Chunk, in RAM and on the GPU
+    std::size_t memoryUsage();
 
-    // Update VBOs of neighbor chunks when a new chunk is generated
-    void update_neighbor_chunks();
+    // Draw from the shared quad index buffer
+    bool bindIdx() override;
+    bool bind_idx_transparent() override;
+    GLenum idxType() override;
+    GLenum idx_type_transparent() override;
 
-    // Determine if a block is transparent
-    bool is_transparent(BlockType t);
-    // MM2
-    void setChunkPos(int x, int z);
-    glm::ivec2 getChunkPos();
+    // Uploads the mesh, then frees the CPU-side copy. A mesh of only
+    // some sections replaces their quads and keeps the rest of the buffers.
     void sendVBO();
 
     void clear_VBO_data();
 };
-
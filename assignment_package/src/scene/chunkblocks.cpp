@@ -0,0 +1,765 @@
+#include "chunkblocks.h"
+#include "blockregistry.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+ChunkBlocks::ChunkBlocks()
+    : m_sections(), m_sectionBlocks(), m_dirty(false), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}},
+      chunkPos()
+{}
+
+ChunkBlocks::~ChunkBlocks()
+{}
+
+// Does bounds checking like std::array::at()
+BlockType ChunkBlocks::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
+    if (x >= 16 || y >= 256 || z >= 16) {
+        throw std::out_of_range("Block " + std::to_string(x) + " " + std::to_string(y) + " " +
+                                std::to_string(z) + " is outside the chunk!");
+    }
+    const sPtr<BlockStorage> &section = m_sections[y / 16];
+    if (section == nullptr) {
+        return EMPTY;
+    }
+    return section->get(x + 16 * (y % 16) + 16 * 16 * z);
+}
+
+// Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
+BlockType ChunkBlocks::getBlockAt(int x, int y, int z) const {
+    return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
+}
+
+// Does bounds checking like std::array::at()
+void ChunkBlocks::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
+    if (x >= 16 || y >= 256 || z >= 16) {
+        throw std::out_of_range("Block " + std::to_string(x) + " " + std::to_string(y) + " " +
+                                std::to_string(z) + " is outside the chunk!");
+    }
+    int s = y / 16;
+    sPtr<BlockStorage> &section = m_sections[s];
+    if (section == nullptr) {
+        if (t == EMPTY) {
+            return;
+        }
+        section = mkS<BlockStorage>(16 * 16 * 16, EMPTY);
+    }
+
+    unsigned int i = x + 16 * (y % 16) + 16 * 16 * z;
+    BlockType old = section->get(i);
+    if (old == t) {
+        return;
+    }
+    writableSection(s)->set(i, t);
+
+    if (old == EMPTY) {
+        m_sectionBlocks[s]++;
+    } else if (t == EMPTY && --m_sectionBlocks[s] == 0) {
+        // Free sections that have been dug out completely
+        section = nullptr;
+    }
+}
+
+void ChunkBlocks::fillBox(glm::ivec3 min, glm::ivec3 max, BlockType t) {
+    int x0 = std::max(min.x, 0), x1 = std::min(max.x, 15);
+    int y0 = std::max(min.y, 0), y1 = std::min(max.y, 255);
+    int z0 = std::max(min.z, 0), z1 = std::min(max.z, 15);
+    if (x0 > x1 || y0 > y1 || z0 > z1) {
+        return;
+    }
+
+    for (int s = y0 / 16; s <= y1 / 16; s++) {
+        sPtr<BlockStorage> &section = m_sections[s];
+        if (section == nullptr) {
+            if (t == EMPTY) {
+                continue;
+            }
+            section = mkS<BlockStorage>(16 * 16 * 16, EMPTY);
+        }
+        writableSection(s);
+
+        int count = m_sectionBlocks[s];
+        for (int z = z0; z <= z1; z++) {
+            for (int y = std::max(y0, s * 16); y <= std::min(y1, s * 16 + 15); y++) {
+                for (int x = x0; x <= x1; x++) {
+                    unsigned int i = x + 16 * (y % 16) + 16 * 16 * z;
+                    BlockType old = section->get(i);
+                    if (old == t) {
+                        continue;
+                    }
+                    section->set(i, t);
+                    if (old == EMPTY) {
+                        count++;
+                    } else if (t == EMPTY) {
+                        count--;
+                    }
+                }
+            }
+        }
+        m_sectionBlocks[s] = count;
+        if (count == 0) {
+            section = nullptr;
+        }
+    }
+}
+
+bool ChunkBlocks::isSectionEmpty(int s) const {
+    return m_sections[s] == nullptr;
+}
+
+bool ChunkBlocks::getNonEmptyRange(int *minY, int *maxY) const {
+    int lo = 0;
+    while (lo < 16 && isSectionEmpty(lo)) {
+        lo++;
+    }
+    if (lo == 16) {
+        return false;
+    }
+    int hi = 16;
+    while (isSectionEmpty(hi - 1)) {
+        hi--;
+    }
+    *minY = lo * 16;
+    *maxY = hi * 16;
+    return true;
+}
+
+BlockStorage *ChunkBlocks::writableSection(int s) {
+    sPtr<BlockStorage> &section = m_sections[s];
+    // Owners are only added by copying from another owner. Only the
+    // thread that writes this chunk copies from it, and the chunks other
+    // threads copy from (snapshots queued for saving, which
+    // WorldSave::load shares with the chunk it loads, and mesh
+    // snapshots) are never written. So once the count is 1, i.e. no
+    // snapshot holds the section, no other thread can raise it. A stale
+    // count above 1 (a snapshot being released) just costs a needless copy.
+    if (section.use_count() > 1) {
+        section = mkS<BlockStorage>(*section);
+    }
+    return section.get();
+}
+
+void ChunkBlocks::copyBlocksFrom(const ChunkBlocks &other) {
+    m_sections = other.m_sections;
+    m_sectionBlocks = other.m_sectionBlocks;
+}
+
+uPtr<ChunkBlocks> ChunkBlocks::snapshot() const {
+    uPtr<ChunkBlocks> copy = mkU<ChunkBlocks>();
+    copy->copyBlocksFrom(*this);
+    copy->chunkPos = chunkPos;
+    return copy;
+}
+
+static void writeVarint(std::vector<uint8_t> *out, uint32_t v) {
+    while (v >= 0x80) {
+        out->push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back(static_cast<uint8_t>(v));
+}
+
+static uint32_t readVarint(const uint8_t **data, const uint8_t *end) {
+    uint32_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (*data == end || shift > 28) {
+            throw std::runtime_error("Truncated varint in saved chunk");
+        }
+        uint8_t byte = *(*data)++;
+        v |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return v;
+        }
+    }
+}
+
+// Each run is its length as a little-endian base-128 varint, then
+// its BlockType. Blocks are visited section by section, each in the
+// order BlockStorage keeps them.
+void ChunkBlocks::serialize(std::vector<uint8_t> *out) const {
+    auto writeRun = [out](uint32_t length, BlockType t) {
+        writeVarint(out, length);
+        out->push_back(t);
+    };
+
+    BlockType section[16 * 16 * 16];
+    BlockType runType = EMPTY;
+    uint32_t runLength = 0;
+    for (int s = 0; s < 16; s++) {
+        if (m_sections[s] == nullptr) {
+            if (runType != EMPTY && runLength > 0) {
+                writeRun(runLength, runType);
+                runLength = 0;
+            }
+            runType = EMPTY;
+            runLength += 16 * 16 * 16;
+            continue;
+        }
+        m_sections[s]->copyTo(section);
+        for (BlockType t : section) {
+            if (t != runType && runLength > 0) {
+                writeRun(runLength, runType);
+                runLength = 0;
+            }
+            runType = t;
+            runLength++;
+        }
+    }
+    writeRun(runLength, runType);
+}
+
+void ChunkBlocks::deserialize(const uint8_t *data, std::size_t size) {
+    // Unpacked one section at a time, then packed all at once. Nothing
+    // is replaced until the whole chunk has been read.
+    std::array<sPtr<BlockStorage>, 16> sections;
+    std::array<int, 16> sectionBlocks;
+    BlockType section[16 * 16 * 16];
+    const uint8_t *end = data + size;
+    int s = 0;
+    uint32_t filled = 0, count = 0;
+    while (data != end) {
+        uint32_t length = readVarint(&data, end);
+        if (data == end) {
+            throw std::runtime_error("Truncated block run in saved chunk");
+        }
+        if (*data >= BLOCK_TYPE_COUNT) {
+            throw std::runtime_error("Unknown block type " + std::to_string(*data) + " in saved chunk");
+        }
+        BlockType t = static_cast<BlockType>(*data++);
+        if (length > (16 - s) * 4096u - filled) {
+            throw std::runtime_error("Saved chunk holds more than 65536 blocks");
+        }
+
+        while (length > 0) {
+            uint32_t n = std::min(length, 4096 - filled);
+            std::fill_n(section + filled, n, t);
+            count += t != EMPTY ? n : 0;
+            filled += n;
+            length -= n;
+            if (filled == 4096) {
+                sectionBlocks[s] = count;
+                if (count > 0) {
+                    sections[s] = mkS<BlockStorage>(16 * 16 * 16, EMPTY);
+                    sections[s]->assign(section);
+                }
+                s++;
+                filled = 0;
+                count = 0;
+            }
+        }
+    }
+    if (s != 16) {
+        throw std::runtime_error("Saved chunk holds fewer than 65536 blocks");
+    }
+    m_sections = std::move(sections);
+    m_sectionBlocks = sectionBlocks;
+}
+
+// Each run of changed blocks is the number of unchanged blocks since the
+// previous run, its length and its BlockType
+void ChunkBlocks::serializeDelta(const ChunkBlocks &base, std::vector<uint8_t> *out) const {
+    BlockType section[16 * 16 * 16], baseSection[16 * 16 * 16];
+    uint32_t unchanged = 0, runLength = 0;
+    BlockType runType = EMPTY;
+    auto endRun = [&]() {
+        if (runLength > 0) {
+            writeVarint(out, unchanged);
+            writeVarint(out, runLength);
+            out->push_back(runType);
+            unchanged = 0;
+            runLength = 0;
+        }
+    };
+
+    for (int s = 0; s < 16; s++) {
+        if (m_sections[s] == nullptr && base.m_sections[s] == nullptr) {
+            endRun();
+            unchanged += 16 * 16 * 16;
+            continue;
+        }
+        if (m_sections[s] == nullptr) {
+            std::fill_n(section, 16 * 16 * 16, EMPTY);
+        } else {
+            m_sections[s]->copyTo(section);
+        }
+        if (base.m_sections[s] == nullptr) {
+            std::fill_n(baseSection, 16 * 16 * 16, EMPTY);
+        } else {
+            base.m_sections[s]->copyTo(baseSection);
+        }
+
+        for (int i = 0; i < 16 * 16 * 16; i++) {
+            if (section[i] == baseSection[i]) {
+                endRun();
+                unchanged++;
+            } else {
+                if (runLength > 0 && section[i] != runType) {
+                    endRun();
+                }
+                runType = section[i];
+                runLength++;
+            }
+        }
+    }
+    endRun();
+}
+
+void ChunkBlocks::applyDelta(const uint8_t *data, std::size_t size) {
+    const uint8_t *end = data + size;
+    uint32_t i = 0;
+    while (data != end) {
+        uint32_t unchanged = readVarint(&data, end);
+        uint32_t length = readVarint(&data, end);
+        if (data == end) {
+            throw std::runtime_error("Truncated block run in saved chunk delta");
+        }
+        if (*data >= BLOCK_TYPE_COUNT) {
+            throw std::runtime_error("Unknown block type " + std::to_string(*data) + " in saved chunk delta");
+        }
+        BlockType t = static_cast<BlockType>(*data++);
+        // i never passes the end of the chunk, so neither sum can wrap
+        if (unchanged > 16 * 16 * 256 - i || length > 16 * 16 * 256 - i - unchanged) {
+            throw std::runtime_error("Saved chunk delta reaches past the chunk");
+        }
+        i += unchanged;
+        for (; length > 0; length--, i++) {
+            uint32_t local = i % 4096;
+            setBlockAt(local % 16, i / 4096 * 16 + local / 16 % 16, local / 256, t);
+        }
+    }
+}
+
+bool ChunkBlocks::isDirty() const {
+    return m_dirty;
+}
+
+void ChunkBlocks::setDirty(bool dirty) {
+    m_dirty = dirty;
+}
+
+const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection {
+    {XPOS, XNEG},
+    {XNEG, XPOS},
+    {YPOS, YNEG},
+    {YNEG, YPOS},
+    {ZPOS, ZNEG},
+    {ZNEG, ZPOS}
+};
+
+void ChunkBlocks::linkNeighbor(ChunkBlocks *neighbor, Direction dir) {
+    if(neighbor != nullptr) {
+        this->m_neighbors[dir] = neighbor;
+        neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
+    }
+}
+
+void ChunkBlocks::unlinkNeighbors() {
+    for (auto &[dir, neighbor] : m_neighbors) {
+        if (neighbor != nullptr) {
+            neighbor->m_neighbors[oppositeDirection.at(dir)] = nullptr;
+            neighbor = nullptr;
+        }
+    }
+}
+
+ChunkBlocks *ChunkBlocks::getNeighbor(Direction dir) const {
+    return m_neighbors.at(dir);
+}
+
+std::size_t ChunkBlocks::blockMemoryUsage() const {
+    std::size_t bytes = 0;
+    for (const sPtr<BlockStorage> &section : m_sections) {
+        if (section != nullptr) {
+            bytes += sizeof(BlockStorage) + section->memoryUsage();
+        }
+    }
+    return bytes;
+}
+
+// Unit-quad corners of each face, in counter-clockwise winding order
+// when seen from outside the block. The index of a corner in its list
+// is the corner id stored in the packed vertex.
+static const glm::ivec3 faceCorners[6][4] {
+    // XPOS
+    {glm::ivec3(1, 0, 1), glm::ivec3(1, 0, 0), glm::ivec3(1, 1, 0), glm::ivec3(1, 1, 1)},
+    // XNEG
+    {glm::ivec3(0, 0, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 1, 1), glm::ivec3(0, 1, 0)},
+    // YPOS
+    {glm::ivec3(0, 1, 1), glm::ivec3(1, 1, 1), glm::ivec3(1, 1, 0), glm::ivec3(0, 1, 0)},
+    // YNEG
+    {glm::ivec3(0, 0, 0), glm::ivec3(1, 0, 0), glm::ivec3(1, 0, 1), glm::ivec3(0, 0, 1)},
+    // ZPOS
+    {glm::ivec3(0, 0, 1), glm::ivec3(1, 0, 1), glm::ivec3(1, 1, 1), glm::ivec3(0, 1, 1)},
+    // ZNEG
+    {glm::ivec3(1, 0, 0), glm::ivec3(0, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(1, 1, 0)}
+};
+
+static const glm::ivec3 faceNormals[6] {
+    glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0),
+    glm::ivec3(0, 1, 0), glm::ivec3(0, -1, 0),
+    glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1)
+};
+
+// Packs one vertex into the layout documented above ChunkVBOData
+static glm::uvec2 packVertex(glm::ivec3 pos, Direction dir, unsigned int corner, BlockType t) {
+    uint32_t position = static_cast<uint32_t>(pos.x)
+                    | static_cast<uint32_t>(pos.y) << 5
+                    | static_cast<uint32_t>(pos.z) << 14;
+    uint32_t face = static_cast<uint32_t>(dir) << 19
+                | corner << 22
+                | static_cast<uint32_t>(blockInfo(t).animated) << 24;
+    return glm::uvec2(position | face, blockInfo(t).tiles[dir]);
+}
+
+// Appends a quad covering the given face of the box of blocks
+// that starts at origin and spans size blocks along each axis
+static void appendFace(std::vector<glm::uvec2> &vec_data,
+                       Direction dir, glm::ivec3 origin, glm::ivec3 size, BlockType t) {
+    for (unsigned int i = 0; i < 4; i++) {
+        vec_data.push_back(packVertex(origin + faceCorners[dir][i] * size, dir, i, t));
+    }
+}
+
+bool ChunkBlocks::greedyMeshing = true;
+
+PaddedBlocks::PaddedBlocks()
+    : m_blocks(SIZE_XZ * SIZE_Y * SIZE_XZ, EMPTY), m_emptySections()
+{}
+
+bool PaddedBlocks::isSectionEmpty(int s) const {
+    return m_emptySections[s];
+}
+
+void ChunkBlocks::copyPadded(PaddedBlocks *out, uint16_t sections) const {
+    // A section's faces also depend on the layers just above and below it
+    const uint16_t copied = sections | sections << 1 | sections >> 1;
+    BlockType *blocks = out->m_blocks.data();
+    BlockType section[16 * 16 * 16];
+    for (int s = 0; s < 16; s++) {
+        out->m_emptySections[s] = isSectionEmpty(s);
+        if (!(copied >> s & 1)) {
+            continue;
+        }
+        for (int x = 0; x < 16; x++) {
+            for (int z = 0; z < 16; z++) {
+                BlockType *column = blocks + PaddedBlocks::index(x, 16 * s, z);
+                if (m_sections[s] == nullptr) {
+                    std::fill_n(column, 16, EMPTY);
+                    continue;
+                }
+                if (x == 0 && z == 0) {
+                    m_sections[s]->copyTo(section);
+                }
+                for (int y = 0; y < 16; y++) {
+                    column[y] = section[x + 16 * y + 16 * 16 * z];
+                }
+            }
+        }
+    }
+
+    // The column of cells just outside each side, and the column of
+    // the neighbor it is copied from
+    const struct {
+        Direction dir;
+        glm::ivec2 cell, from, along;
+    } borders[4] = {
+        {XPOS, glm::ivec2(16, 0), glm::ivec2(0, 0), glm::ivec2(0, 1)},
+        {XNEG, glm::ivec2(-1, 0), glm::ivec2(15, 0), glm::ivec2(0, 1)},
+        {ZPOS, glm::ivec2(0, 16), glm::ivec2(0, 0), glm::ivec2(1, 0)},
+        {ZNEG, glm::ivec2(0, -1), glm::ivec2(0, 15), glm::ivec2(1, 0)}
+    };
+    for (const auto &b : borders) {
+        const ChunkBlocks *neighbor = m_neighbors.at(b.dir);
+        for (int k = 0; k < 16; k++) {
+            glm::ivec2 cell = b.cell + k * b.along;
+            glm::ivec2 from = b.from + k * b.along;
+            BlockType *column = blocks + PaddedBlocks::index(cell.x, 0, cell.y);
+            if (neighbor == nullptr) {
+                std::fill_n(column, 256, WATER);
+                continue;
+            }
+            for (int s = 0; s < 16; s++) {
+                if (!(copied >> s & 1)) {
+                    continue;
+                }
+                const BlockStorage *storage = neighbor->m_sections[s].get();
+                for (int y = 0; y < 16; y++) {
+                    column[16 * s + y] = storage == nullptr ? EMPTY : storage->get(from.x + 16 * y + 16 * 16 * from.y);
+                }
+            }
+        }
+    }
+}
+
+MeshSnapshot ChunkBlocks::meshSnapshot() const {
+    const Direction dirs[4] = {XPOS, XNEG, ZPOS, ZNEG};
+    MeshSnapshot snap;
+    snap.chunk = snapshot();
+    for (int i = 0; i < 4; i++) {
+        const ChunkBlocks *neighbor = m_neighbors.at(dirs[i]);
+        if (neighbor != nullptr) {
+            snap.neighbors[i] = neighbor->snapshot();
+            snap.chunk->linkNeighbor(snap.neighbors[i].get(), dirs[i]);
+        }
+    }
+    return snap;
+}
+
+ChunkVBOData ChunkBlocks::buildVBOdata(uint16_t sections) const {
+    // Kept between calls; sections not copied this time are never read
+    thread_local PaddedBlocks blocks;
+    copyPadded(&blocks, sections);
+    return buildVBOdata(blocks, sections);
+}
+
+ChunkVBOData ChunkBlocks::buildVBOdata(const PaddedBlocks &blocks, uint16_t sections) {
+    // The vertices grow here, in vectors that keep their capacity from
+    // one mesh to the next, and are copied out once at their final size
+    thread_local ChunkVBOData scratch;
+    scratch.vec_data.clear();
+    scratch.vec_data_trans.clear();
+    ChunkVBOData data;
+    data.sections = sections;
+    for (int s = 0; s < 16; s++) {
+        if (!(sections >> s & 1) || blocks.isSectionEmpty(s)) {
+            continue;
+        }
+        std::size_t quads = scratch.vec_data.size() / 4;
+        std::size_t quadsTrans = scratch.vec_data_trans.size() / 4;
+        if (greedyMeshing) {
+            createVBOdataGreedy(blocks, s, scratch);
+        } else {
+            createVBOdataNaive(blocks, s, scratch);
+        }
+        data.sectionQuads[s] = static_cast<uint32_t>(scratch.vec_data.size() / 4 - quads);
+        data.sectionQuadsTrans[s] = static_cast<uint32_t>(scratch.vec_data_trans.size() / 4 - quadsTrans);
+    }
+    data.vec_data.assign(scratch.vec_data.begin(), scratch.vec_data.end());
+    data.vec_data_trans.assign(scratch.vec_data_trans.begin(), scratch.vec_data_trans.end());
+    return data;
+}
+
+// The visible faces of one section, as one 16-bit mask per column and
+// direction: bit y of visible[d][x * 16 + z] is set if the face of
+// block (x, y, z) of the section that points in direction d is visible
+struct SectionFaces {
+    uint16_t visible[6][16 * 16];
+    // Is any bit of visible[d] set?
+    bool any[6];
+};
+
+// Finds the visible faces of section s for whole columns at once. Each
+// column of the section and of its border, with the blocks just below
+// and above it, becomes two 18-bit masks: which cells hold a block and
+// which hold an opaque one. A face is visible where an opaque block
+// borders a cell with no opaque block, or a transparent block borders
+// an EMPTY cell, so every direction is a few shifts and ANDs per column.
+static void findVisibleFaces(const PaddedBlocks &blocks, int s, SectionFaces *faces) {
+    const int COLUMNS = PaddedBlocks::SIZE_XZ;
+    uint32_t solid[COLUMNS * COLUMNS], opaque[COLUMNS * COLUMNS];
+    for (int x = -1; x <= 16; x++) {
+        for (int z = -1; z <= 16; z++) {
+            int first = PaddedBlocks::index(x, 16 * s - 1, z);
+            uint32_t solidBits = 0, opaqueBits = 0;
+            for (int k = 0; k < 18; k++) {
+                BlockType t = blocks.at(first + k);
+                solidBits |= static_cast<uint32_t>(t != EMPTY) << k;
+                opaqueBits |= static_cast<uint32_t>(blockInfo(t).opaque) << k;
+            }
+            solid[(x + 1) * COLUMNS + z + 1] = solidBits;
+            opaque[(x + 1) * COLUMNS + z + 1] = opaqueBits;
+        }
+    }
+
+    // Offsets to the neighboring column in each horizontal direction
+    const int columnStep[6] = {COLUMNS, -COLUMNS, 0, 0, 1, -1};
+    uint32_t any[6] = {};
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            int c = (x + 1) * COLUMNS + z + 1;
+            uint32_t transparent = solid[c] & ~opaque[c];
+            for (int d = 0; d < 6; d++) {
+                uint32_t solidNext, opaqueNext;
+                if (d == YPOS) {
+                    solidNext = solid[c] >> 1;
+                    opaqueNext = opaque[c] >> 1;
+                } else if (d == YNEG) {
+                    solidNext = solid[c] << 1;
+                    opaqueNext = opaque[c] << 1;
+                } else {
+                    solidNext = solid[c + columnStep[d]];
+                    opaqueNext = opaque[c + columnStep[d]];
+                }
+                uint32_t visible = (opaque[c] & ~opaqueNext) | (transparent & ~solidNext);
+                // Bit 0 is the cell below the section
+                uint16_t bits = static_cast<uint16_t>(visible >> 1);
+                faces->visible[d][x * 16 + z] = bits;
+                any[d] |= bits;
+            }
+        }
+    }
+    for (int d = 0; d < 6; d++) {
+        faces->any[d] = any[d] != 0;
+    }
+}
+
+// Greedy meshing: for every slice of the section perpendicular to a face
+// direction, build a mask of the visible faces, then grow each unvisited
+// face into the largest rectangle of faces sharing its BlockType and emit
+// it as a single quad. The tile is repeated across the quad in the shader.
+// Quads stop at the section boundaries, so each section can be meshed
+// again on its own.
+void ChunkBlocks::createVBOdataGreedy(const PaddedBlocks &blocks, int s, ChunkVBOData &out) {
+    std::vector<glm::uvec2> &vec_data = out.vec_data;
+    std::vector<glm::uvec2> &vec_data_transparent = out.vec_data_trans;
+
+    const int dims[3] = {16, 16, 16};
+    const int strides[3] = {PaddedBlocks::STRIDE_X, PaddedBlocks::STRIDE_Y, PaddedBlocks::STRIDE_Z};
+    const glm::ivec3 base(0, 16 * s, 0);
+    BlockType mask[16 * 16];
+    SectionFaces faces;
+    findVisibleFaces(blocks, s, &faces);
+
+    for (int d = 0; d < 6; d++) {
+        if (!faces.any[d]) {
+            continue;
+        }
+        Direction dir = static_cast<Direction>(d);
+        glm::ivec3 normal = faceNormals[d];
+        // Axis the faces point along, and the two axes spanning the slice
+        int axis = normal.x != 0 ? 0 : (normal.y != 0 ? 1 : 2);
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        int du = dims[u];
+        int dv = dims[v];
+
+        for (int slice = 0; slice < dims[axis]; slice++) {
+            glm::ivec3 corner = base;
+            corner[axis] += slice;
+            int first = PaddedBlocks::index(corner.x, corner.y, corner.z);
+
+            // Collect the visible faces of this slice
+            bool anyVisible = false;
+            for (int j = 0; j < dv; j++) {
+                for (int i = 0; i < du; i++) {
+                    glm::ivec3 p;
+                    p[axis] = slice;
+                    p[u] = i;
+                    p[v] = j;
+                    bool visible = faces.visible[d][p.x * 16 + p.z] >> p.y & 1;
+                    mask[i + j * du] = visible ? blocks.at(first + i * strides[u] + j * strides[v]) : EMPTY;
+                    anyVisible |= visible;
+                }
+            }
+            if (!anyVisible) {
+                continue;
+            }
+
+            // Merge runs of identical faces into rectangles
+            for (int j = 0; j < dv; j++) {
+                for (int i = 0; i < du;) {
+                    BlockType t = mask[i + j * du];
+                    if (t == EMPTY) {
+                        i++;
+                        continue;
+                    }
+
+                    // Animated surfaces are displaced per vertex along x
+                    // in the vertex shader, so never stretch them along x
+                    bool animated = blockInfo(t).animated;
+
+                    int w = 1;
+                    while (i + w < du && mask[i + w + j * du] == t && !(animated && u == 0)) {
+                        w++;
+                    }
+
+                    int h = 1;
+                    while (j + h < dv && !(animated && v == 0)) {
+                        bool rowMatches = true;
+                        for (int k = 0; k < w; k++) {
+                            if (mask[i + k + (j + h) * du] != t) {
+                                rowMatches = false;
+                                break;
+                            }
+                        }
+                        if (!rowMatches) {
+                            break;
+                        }
+                        h++;
+                    }
+
+                    glm::ivec3 origin, size;
+                    origin[axis] = slice;
+                    origin[u] = i;
+                    origin[v] = j;
+                    size[axis] = 1;
+                    size[u] = w;
+                    size[v] = h;
+                    origin += base;
+                    if (is_transparent(t)) {
+                        appendFace(vec_data_transparent, dir, origin, size, t);
+                    } else {
+                        appendFace(vec_data, dir, origin, size, t);
+                    }
+
+                    // Consume the merged faces
+                    for (int l = 0; l < h; l++) {
+                        std::fill_n(mask + i + (j + l) * du, w, EMPTY);
+                    }
+                    i += w;
+                }
+            }
+        }
+    }
+}
+
+void ChunkBlocks::createVBOdataNaive(const PaddedBlocks &blocks, int s, ChunkVBOData &out) {
+    std::vector<glm::uvec2> &vec_data = out.vec_data;
+
+    // Store data for transparent blocks
+    std::vector<glm::uvec2> &vec_data_transparent = out.vec_data_trans;
+
+    SectionFaces faces;
+    findVisibleFaces(blocks, s, &faces);
+
+    // Emit one quad per visible face, column by column
+    for (int d = 0; d < 6; d++) {
+        if (!faces.any[d]) {
+            continue;
+        }
+        Direction dir = static_cast<Direction>(d);
+        for (int x = 0; x < 16; x++) {
+            for (int z = 0; z < 16; z++) {
+                uint16_t bits = faces.visible[d][x * 16 + z];
+                for (int y = 0; bits != 0; y++, bits >>= 1) {
+                    if (!(bits & 1)) {
+                        continue;
+                    }
+                    glm::ivec3 p(x, 16 * s + y, z);
+                    BlockType t = blocks.at(p.x, p.y, p.z);
+                    if (is_transparent(t)) {
+                        appendFace(vec_data_transparent, dir, p, glm::ivec3(1), t);
+                    } else {
+                        appendFace(vec_data, dir, p, glm::ivec3(1), t);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool ChunkBlocks::is_transparent(BlockType t) {
+    return t != EMPTY && !blockInfo(t).opaque;
+}
+
+void ChunkBlocks::setChunkPos(int x, int z)
+{
+    int x_floor = static_cast<int>(glm::floor(x / 16.f));
+    int z_floor = static_cast<int>(glm::floor(z / 16.f));
+    chunkPos = glm::ivec2(16 * x_floor, 16 * z_floor);
+}
+glm::ivec2 ChunkBlocks::getChunkPos() const
+{
+    return chunkPos;
+}
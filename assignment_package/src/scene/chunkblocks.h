@@ -0,0 +1,233 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "glm_includes.h"
+#include "blocktype.h"
+#include "blockstorage.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// The block data and mesh building of a Chunk, without any OpenGL.
+// This part of the terrain (along with BlockStorage, ProcedureTerrain
+// and TerrainGenerator) builds into the headless terraincore library.
+
+// The six cardinal directions in 3D space
+enum Direction : unsigned char
+{
+    XPOS, XNEG, YPOS, YNEG, ZPOS, ZNEG
+};
+
+// Lets us use any enum class as the key of a
+// std::unordered_map
+struct EnumHash {
+    template <typename T>
+    size_t operator()(T t) const {
+        return static_cast<size_t>(t);
+    }
+};
+
+// MM2
+// Chunk vertices are packed into two 32-bit words (8 bytes):
+//   x:     bits 0-4   of .x  (0-16, chunk-local)
+//   y:     bits 5-13  of .x  (0-256)
+//   z:     bits 14-18 of .x  (0-16, chunk-local)
+//   face:  bits 19-21 of .x  (Direction of the face normal)
+//   corner: bits 22-23 of .x (which corner of its quad this vertex is)
+//   animated: bit 24  of .x  (WATER and LAVA)
+//   tile:  bits 0-7   of .y  (index of the atlas tile, row * 16 + column)
+// lambert.vert.glsl unpacks them.
+// Vertices come in groups of four, one group per quad, so they are
+// drawn with the indices in the shared QuadIndexBuffer.
+// The quads of each 16-block section are contiguous and in section
+// order, so the mesh of a few sections can replace theirs in place.
+// Move-only: a mesh is handed from the worker that built it to the
+// upload, and its vertex data is freed once it is on the GPU.
+class Chunk;
+struct ChunkVBOData
+{
+    ChunkVBOData() = default;
+    ChunkVBOData(ChunkVBOData&&) = default;
+    ChunkVBOData &operator=(ChunkVBOData&&) = default;
+    ChunkVBOData(const ChunkVBOData&) = delete;
+    ChunkVBOData &operator=(const ChunkVBOData&) = delete;
+
+    Chunk* chunk = nullptr;
+    // Chunk::meshVersion() at the time the mesh was requested
+    int version = 0;
+    // Bit s is set if the mesh holds the quads of section s. Sections
+    // not in the mask keep the quads they were last uploaded with.
+    uint16_t sections = 0xFFFF;
+    std::vector<glm::uvec2> vec_data, vec_data_trans;
+    // Quads each section contributes to vec_data and vec_data_trans
+    std::array<uint32_t, 16> sectionQuads{}, sectionQuadsTrans{};
+};
+
+// The blocks a chunk's mesh depends on, copied into one contiguous
+// 18 x 258 x 18 array: the chunk's own 16 x 256 x 16 blocks and a
+// one-block border taken from its four neighbors and from the space
+// above and below the world. The mesher reads only this array, so it
+// needs no neighbor lookups or bounds checks, and the chunks it was
+// copied from may change while it runs.
+// Cells are indexed by chunk-local coordinates, with x and z in
+// [-1, 16] and y in [-1, 256]. The four corner columns are never read.
+class PaddedBlocks {
+public:
+    static constexpr int SIZE_XZ = 18;
+    static constexpr int SIZE_Y = 258;
+    // Index offsets between neighboring cells along each axis
+    static constexpr int STRIDE_Y = 1;
+    static constexpr int STRIDE_Z = SIZE_Y;
+    static constexpr int STRIDE_X = SIZE_Y * SIZE_XZ;
+
+    // Every cell EMPTY, as the cells above and below the world stay
+    PaddedBlocks();
+
+    static int index(int x, int y, int z);
+    BlockType at(int i) const;
+    BlockType at(int x, int y, int z) const;
+    // Does section s of the chunk hold only EMPTY?
+    bool isSectionEmpty(int s) const;
+
+private:
+    friend class ChunkBlocks;
+    std::vector<BlockType> m_blocks;
+    std::array<bool, 16> m_emptySections;
+};
+
+inline int PaddedBlocks::index(int x, int y, int z) {
+    return (x + 1) * STRIDE_X + (z + 1) * STRIDE_Z + (y + 1) * STRIDE_Y;
+}
+
+inline BlockType PaddedBlocks::at(int i) const {
+    return m_blocks[i];
+}
+
+inline BlockType PaddedBlocks::at(int x, int y, int z) const {
+    return m_blocks[index(x, y, z)];
+}
+
+struct MeshSnapshot;
+
+// The blocks of one 16 x 256 x 16 column of the world, and the code
+// that turns them into vertex data. Chunk adds the GL buffers.
+class ChunkBlocks {
+protected:
+    // All of the blocks contained within this Chunk, as 16 palette-
+    // compressed 16 x 16 x 16 sections stacked along y. A section
+    // holding only EMPTY blocks has no storage at all. Sections are
+    // shared with snapshots until one side writes to them.
+    std::array<sPtr<BlockStorage>, 16> m_sections;
+    // Number of non-EMPTY blocks in each section
+    std::array<int, 16> m_sectionBlocks;
+    // Do the blocks differ from what is saved on disk?
+    bool m_dirty;
+    // This Chunk's four neighbors to the north, south, east, and west
+    // The third input to this map just lets us use a Direction as
+    // a key for this map.
+    // These allow us to properly determine
+    std::unordered_map<Direction, ChunkBlocks*, EnumHash> m_neighbors;
+
+    // MM2
+    glm::ivec2 chunkPos;
+
+    // Append the quads of section s to out. Emits one quad per visible
+    // block face.
+    static void createVBOdataNaive(const PaddedBlocks &blocks, int s, ChunkVBOData &out);
+    // Merges coplanar visible faces of the same BlockType within the
+    // section into larger quads
+    static void createVBOdataGreedy(const PaddedBlocks &blocks, int s, ChunkVBOData &out);
+    // Section s, copied first if a snapshot shares it. s must not be empty.
+    BlockStorage *writableSection(int s);
+
+public:
+    // Selects the mesher used by buildVBOdata(). Greedy meshing
+    // is on by default; set to false to emit one quad per face.
+    static bool greedyMeshing;
+    static constexpr uint16_t ALL_SECTIONS = 0xFFFF;
+
+    ChunkBlocks();
+    virtual ~ChunkBlocks();
+
+    BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
+    BlockType getBlockAt(int x, int y, int z) const;
+    void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+    // Sets every block in the box from min to max (inclusive, chunk-local)
+    // to t. The box may reach outside the chunk; only the part inside is
+    // written. Cheaper than setBlockAt for each block.
+    void fillBox(glm::ivec3 min, glm::ivec3 max, BlockType t);
+    // Does section s (blocks s * 16 to s * 16 + 15 in y) hold only EMPTY?
+    bool isSectionEmpty(int s) const;
+    // Sets minY and maxY to the y range [minY, maxY) spanned by the
+    // non-empty sections. Returns false if the whole Chunk is EMPTY.
+    bool getNonEmptyRange(int *minY, int *maxY) const;
+    // Bytes held by the block sections
+    std::size_t blockMemoryUsage() const;
+
+    // Replaces every block with the blocks of other. The sections are
+    // shared, not copied, until either chunk changes them.
+    void copyBlocksFrom(const ChunkBlocks &other);
+    // A copy-on-write copy of the blocks (only), e.g. to save them on
+    // another thread while this chunk keeps being edited. Costs 16
+    // reference counts, not a copy of the blocks. Once the copy is handed
+    // to another thread it must not be written, since that thread may
+    // share its sections with yet another chunk (see writableSection).
+    uPtr<ChunkBlocks> snapshot() const;
+    // Appends the blocks to out as runs of one BlockType, following each
+    // column from y = 0 up. Terrain columns are a handful of runs, so a
+    // chunk usually takes a few KiB.
+    void serialize(std::vector<uint8_t> *out) const;
+    // Replaces every block with the ones serialize() wrote to data.
+    // Throws std::runtime_error if the data is malformed.
+    void deserialize(const uint8_t *data, std::size_t size);
+    // Appends the blocks that differ from those of base to out, as
+    // runs of changed blocks of one BlockType in the order serialize()
+    // uses. Writes nothing if the chunks are identical.
+    void serializeDelta(const ChunkBlocks &base, std::vector<uint8_t> *out) const;
+    // Sets the blocks serializeDelta() wrote to data. Throws
+    // std::runtime_error if the data is malformed.
+    void applyDelta(const uint8_t *data, std::size_t size);
+    bool isDirty() const;
+    void setDirty(bool dirty);
+
+    void linkNeighbor(ChunkBlocks *neighbor, Direction dir);
+    // Clears the neighbors' pointers to this Chunk and this Chunk's to them
+    void unlinkNeighbors();
+    ChunkBlocks *getNeighbor(Direction dir) const;
+
+    // Copies the blocks and the borders of the linked neighbors into out.
+    // A missing neighbor reads as WATER, so opaque faces toward it are
+    // shown and water faces are hidden. Only the sections in the mask and
+    // the ones above and below them, which their faces depend on, are
+    // copied; the rest of out is left as it was.
+    void copyPadded(PaddedBlocks *out, uint16_t sections = ALL_SECTIONS) const;
+    // Copy-on-write snapshots of the blocks and of the neighbors, to
+    // mesh on a worker thread while this Chunk and its neighbors keep
+    // being edited
+    MeshSnapshot meshSnapshot() const;
+
+    // Builds the vertex data of the visible block faces of the sections
+    // in the mask. Reads the blocks of this Chunk and its neighbors.
+    // The padded copy and the vertices are built in buffers kept by the
+    // calling thread, so a worker that meshes chunk after chunk does not
+    // allocate them again; only the returned mesh is allocated, at its
+    // exact size.
+    ChunkVBOData buildVBOdata(uint16_t sections = ALL_SECTIONS) const;
+    // Builds the vertex data of the sections in the mask from a padded
+    // copy of the blocks
+    static ChunkVBOData buildVBOdata(const PaddedBlocks &blocks, uint16_t sections);
+
+    // Determine if a block is transparent
+    static bool is_transparent(BlockType t);
+    // MM2
+    void setChunkPos(int x, int z);
+    glm::ivec2 getChunkPos() const;
+};
+
+// The blocks of a Chunk and of its neighbors at one moment. The
+// neighbors are linked to chunk, so chunk->buildVBOdata() sees them.
+struct MeshSnapshot {
+    uPtr<ChunkBlocks> chunk;
+    std::array<uPtr<ChunkBlocks>, 4> neighbors;
+};
@@ -0,0 +1,33 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4 &viewProj)
+    : m_planes()
+{
+    // Gribb-Hartmann extraction: combine the fourth row of the clip
+    // matrix with each of the other three. glm is column-major, so
+    // row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    glm::mat4 t = glm::transpose(viewProj);
+    m_planes[0] = t[3] + t[0]; // Left
+    m_planes[1] = t[3] - t[0]; // Right
+    m_planes[2] = t[3] + t[1]; // Bottom
+    m_planes[3] = t[3] - t[1]; // Top
+    m_planes[4] = t[3] + t[2]; // Near
+    m_planes[5] = t[3] - t[2]; // Far
+    for (glm::vec4 &p : m_planes) {
+        p /= glm::length(glm::vec3(p));
+    }
+}
+
+bool Frustum::intersectsAABB(glm::vec3 min, glm::vec3 max) const {
+    for (const glm::vec4 &p : m_planes) {
+        // Test the corner of the box furthest along the plane normal;
+        // if even that corner is outside, the whole box is
+        glm::vec3 corner(p.x >= 0.f ? max.x : min.x,
+                         p.y >= 0.f ? max.y : min.y,
+                         p.z >= 0.f ? max.z : min.z);
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+
+// The six clipping planes of a view-projection matrix, used to
+// skip geometry that lies entirely outside the camera's view.
+class Frustum {
+private:
+    // Each plane is stored as (normal, d) with the normal pointing
+    // into the frustum, so a point p is inside when dot(n, p) + d >= 0
+    std::array<glm::vec4, 6> m_planes;
+
+public:
+    Frustum(const glm::mat4 &viewProj);
+
+    // Returns false only when the axis-aligned box [min, max] lies
+    // completely on the outside of at least one plane
+    bool intersectsAABB(glm::vec3 min, glm::vec3 max) const;
+};
@@ -0,0 +1,100 @@
+// The height and cave noise kernels on 8 points at a time. Only this file's
+// functions are compiled for AVX2 (by target pragma, so the rest of the
+// build keeps the default flags), and ProcedureTerrain only calls them
+// after checking the CPU supports AVX2.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NOISE_AVX2_KERNEL
+#endif
+
+#ifdef NOISE_AVX2_KERNEL
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+#endif
+
+#include "noisekernels.h"
+
+#ifdef NOISE_AVX2_KERNEL
+
+namespace {
+
+struct I8 {
+    __m256i v;
+
+    I8(__m256i m) : v(m) {}
+    I8(uint32_t u) : v(_mm256_set1_epi32(int(u))) {}
+};
+
+inline I8 operator*(I8 a, I8 b) { return I8(_mm256_mullo_epi32(a.v, b.v)); }
+inline I8 operator^(I8 a, I8 b) { return I8(_mm256_xor_si256(a.v, b.v)); }
+inline I8 operator>>(I8 a, int n) { return I8(_mm256_srl_epi32(a.v, _mm_cvtsi32_si128(n))); }
+
+struct F8 {
+    static constexpr int WIDTH = 8;
+    using Mask = __m256;
+    using Int = I8;
+    __m256 v;
+
+    F8(__m256 m) : v(m) {}
+    F8(float f) : v(_mm256_set1_ps(f)) {}
+    static F8 load(const float *p) { return F8(_mm256_loadu_ps(p)); }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline F8 operator+(F8 a, F8 b) { return F8(_mm256_add_ps(a.v, b.v)); }
+inline F8 operator-(F8 a, F8 b) { return F8(_mm256_sub_ps(a.v, b.v)); }
+inline F8 operator*(F8 a, F8 b) { return F8(_mm256_mul_ps(a.v, b.v)); }
+inline F8 operator/(F8 a, F8 b) { return F8(_mm256_div_ps(a.v, b.v)); }
+inline __m256 operator<(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline __m256 operator>=(F8 a, F8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline F8 floorv(F8 a) { return F8(_mm256_floor_ps(a.v)); }
+inline F8 truncv(F8 a) { return F8(_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)); }
+inline F8 sqrtv(F8 a) { return F8(_mm256_sqrt_ps(a.v)); }
+inline F8 absv(F8 a) { return F8(_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)); }
+inline I8 toInt(F8 a) { return I8(_mm256_cvttps_epi32(a.v)); }
+inline F8 unitFloat(I8 h) { return F8(_mm256_mul_ps(_mm256_cvtepi32_ps((h >> 8).v), _mm256_set1_ps(1.f / 16777216.f))); }
+inline F8 select(__m256 m, F8 a, F8 b) { return F8(_mm256_blendv_ps(b.v, a.v, m)); }
+
+int heightNoiseF8(const float *x, const float *z, int n,
+                  const HeightNoiseOctaves &octaves, uint32_t seed,
+                  float *grassland, float *mountain, float *perlin) {
+    return heightNoise<F8>(x, z, n, octaves, seed, grassland, mountain, perlin);
+}
+
+int caveNoiseF8(const float *x, const float *y, const float *z, int n,
+               const NoiseOctaves &octaves, uint32_t seed, float *density) {
+    return caveNoise<F8>(x, y, z, n, octaves, seed, density);
+}
+
+} // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+HeightNoiseKernel heightNoiseAvx2() {
+    return heightNoiseF8;
+}
+
+CaveNoiseKernel caveNoiseAvx2() {
+    return caveNoiseF8;
+}
+
+#else
+
+HeightNoiseKernel heightNoiseAvx2() {
+    return nullptr;
+}
+
+CaveNoiseKernel caveNoiseAvx2() {
+    return nullptr;
+}
+
+#endif
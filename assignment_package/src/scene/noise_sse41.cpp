@@ -0,0 +1,100 @@
+// The height and cave noise kernels on 4 points at a time. Only this file's
+// functions are compiled for SSE4.1 (by target pragma, so the rest of the
+// build keeps the default flags), and ProcedureTerrain only calls them
+// after checking the CPU supports SSE4.1.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NOISE_SSE41_KERNEL
+#endif
+
+#ifdef NOISE_SSE41_KERNEL
+#include <smmintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+#endif
+
+#include "noisekernels.h"
+
+#ifdef NOISE_SSE41_KERNEL
+
+namespace {
+
+struct I4 {
+    __m128i v;
+
+    I4(__m128i m) : v(m) {}
+    I4(uint32_t u) : v(_mm_set1_epi32(int(u))) {}
+};
+
+inline I4 operator*(I4 a, I4 b) { return I4(_mm_mullo_epi32(a.v, b.v)); }
+inline I4 operator^(I4 a, I4 b) { return I4(_mm_xor_si128(a.v, b.v)); }
+inline I4 operator>>(I4 a, int n) { return I4(_mm_srl_epi32(a.v, _mm_cvtsi32_si128(n))); }
+
+struct F4 {
+    static constexpr int WIDTH = 4;
+    using Mask = __m128;
+    using Int = I4;
+    __m128 v;
+
+    F4(__m128 m) : v(m) {}
+    F4(float f) : v(_mm_set1_ps(f)) {}
+    static F4 load(const float *p) { return F4(_mm_loadu_ps(p)); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline F4 operator+(F4 a, F4 b) { return F4(_mm_add_ps(a.v, b.v)); }
+inline F4 operator-(F4 a, F4 b) { return F4(_mm_sub_ps(a.v, b.v)); }
+inline F4 operator*(F4 a, F4 b) { return F4(_mm_mul_ps(a.v, b.v)); }
+inline F4 operator/(F4 a, F4 b) { return F4(_mm_div_ps(a.v, b.v)); }
+inline __m128 operator<(F4 a, F4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline __m128 operator>=(F4 a, F4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline F4 floorv(F4 a) { return F4(_mm_floor_ps(a.v)); }
+inline F4 truncv(F4 a) { return F4(_mm_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)); }
+inline F4 sqrtv(F4 a) { return F4(_mm_sqrt_ps(a.v)); }
+inline F4 absv(F4 a) { return F4(_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)); }
+inline I4 toInt(F4 a) { return I4(_mm_cvttps_epi32(a.v)); }
+inline F4 unitFloat(I4 h) { return F4(_mm_mul_ps(_mm_cvtepi32_ps((h >> 8).v), _mm_set1_ps(1.f / 16777216.f))); }
+inline F4 select(__m128 m, F4 a, F4 b) { return F4(_mm_blendv_ps(b.v, a.v, m)); }
+
+int heightNoiseF4(const float *x, const float *z, int n,
+                  const HeightNoiseOctaves &octaves, uint32_t seed,
+                  float *grassland, float *mountain, float *perlin) {
+    return heightNoise<F4>(x, z, n, octaves, seed, grassland, mountain, perlin);
+}
+
+int caveNoiseF4(const float *x, const float *y, const float *z, int n,
+               const NoiseOctaves &octaves, uint32_t seed, float *density) {
+    return caveNoise<F4>(x, y, z, n, octaves, seed, density);
+}
+
+} // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+HeightNoiseKernel heightNoiseSse41() {
+    return heightNoiseF4;
+}
+
+CaveNoiseKernel caveNoiseSse41() {
+    return caveNoiseF4;
+}
+
+#else
+
+HeightNoiseKernel heightNoiseSse41() {
+    return nullptr;
+}
+
+CaveNoiseKernel caveNoiseSse41() {
+    return nullptr;
+}
+
+#endif
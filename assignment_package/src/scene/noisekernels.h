@@ -0,0 +1,255 @@
+#pragma once
+#include <cstdint>
+// The noise behind ProcedureTerrain::getHeight and the cave density of
+// ProcedureTerrain::getCaveDensities, written once against a
+// "lane" type V so the same code runs on 1 (scalar), 4 (SSE4.1) or
+// 8 (AVX2) columns at a time.
+//
+// This header is included by procedure_terrain.cpp and by one
+// translation unit per instruction set, each compiling it for that
+// instruction set. The kernels live in an anonymous namespace so the copies
+// built for different instruction sets are never merged by the linker,
+// and they only use V's operations so every copy performs the same
+// IEEE float operations in the same order: a column gets bit-identical
+// noise whichever kernel computes it. (The build turns off FMA
+// contraction in the core library for the same reason.)
+//
+// Gradients and feature points come from an integer hash of the grid
+// point and the world seed, so they are the same on every platform.
+//
+// V must provide:
+//   static constexpr int WIDTH
+//   V(float) (broadcast), V::load(const float*), store(float*)
+//   + - * / between Vs
+//   floorv, truncv, sqrtv, absv
+//   a Mask type from < and >=, and select(mask, ifTrue, ifFalse)
+//   an Int type of 32-bit unsigned lanes with Int(uint32_t) (broadcast),
+//   * ^ between Ints and >> by a constant
+//   toInt(V) (of whole-number floats) and unitFloat(Int), which maps the
+//   high 24 bits of each lane to [0, 1)
+
+// Scale and attenuation of each octave of fractalNoise2D for one
+// persistence. Filled in by ProcedureTerrain.
+struct NoiseOctaves {
+    static constexpr int COUNT = 7;
+    float scale[COUNT];
+    float atten[COUNT];
+};
+
+struct HeightNoiseOctaves {
+    NoiseOctaves grassland, mountain, perlin;
+};
+
+// Computes grasslandCoord, mountainCoord and the biome perlin value of
+// getHeight for the columns (x[i], z[i]), i < n. A SIMD kernel only
+// handles whole vectors and returns how many columns it computed; the
+// caller finishes the rest with the scalar kernel.
+using HeightNoiseKernel = int (*)(const float *x, const float *z, int n,
+                                  const HeightNoiseOctaves &octaves, uint32_t seed,
+                                  float *grassland, float *mountain, float *perlin);
+
+// Computes the cave density at the points (x[i], y[i], z[i]), i < n,
+// the same way
+using CaveNoiseKernel = int (*)(const float *x, const float *y, const float *z, int n,
+                                const NoiseOctaves &octaves, uint32_t seed, float *density);
+
+// The SIMD kernels, or nullptr when this build (compiler or target
+// architecture) does not include them. Whether the CPU supports them is
+// checked separately.
+HeightNoiseKernel heightNoiseSse41();
+HeightNoiseKernel heightNoiseAvx2();
+CaveNoiseKernel caveNoiseSse41();
+CaveNoiseKernel caveNoiseAvx2();
+
+namespace {
+
+// Chris Wellons' lowbias32 finalizer
+template <typename U>
+inline U mixHash(U h) {
+    h = h ^ (h >> 16);
+    h = h * U(0x7feb352du);
+    h = h ^ (h >> 15);
+    h = h * U(0x846ca68bu);
+    h = h ^ (h >> 16);
+    return h;
+}
+
+template <typename U>
+inline U hash2D(U x, U z, U seed) {
+    return mixHash(seed ^ (x * U(0x8da6b343u)) ^ (z * U(0xd8163841u)));
+}
+
+template <typename U>
+inline U hash3D(U x, U y, U z, U seed) {
+    return mixHash(seed ^ (x * U(0x8da6b343u)) ^ (y * U(0xd8163841u)) ^ (z * U(0xcb1ab31fu)));
+}
+
+template <typename V>
+inline V fract(V x) {
+    return x - floorv(x);
+}
+
+template <typename V>
+inline V smootherFalloff(V d) {
+    V d3 = d * d * d;
+    V d4 = d3 * d;
+    V d5 = d4 * d;
+    return V(1.f) - V(6.f) * d5 + V(15.f) * d4 - V(10.f) * d3;
+}
+
+template <typename V>
+inline V surflet(V px, V pz, V gx, V gz, typename V::Int seed) {
+    V tx = smootherFalloff(absv(px - gx));
+    V tz = smootherFalloff(absv(pz - gz));
+
+    typename V::Int h = hash2D(toInt(gx), toInt(gz), seed);
+    V nx = unitFloat(h);
+    V nz = unitFloat(mixHash(h));
+    // Both are 0 now and then; the tiny bias keeps that from dividing
+    // 0 by 0 and leaving a NaN (a hole) in the heightmap
+    V invLength = V(1.f) / sqrtv(nx * nx + nz * nz + V(1e-30f));
+    V gradX = nx * invLength * V(2.f) - V(1.f);
+    V gradZ = nz * invLength * V(2.f) - V(1.f);
+
+    return ((px - gx) * gradX + (pz - gz) * gradZ) * tx * tz;
+}
+
+template <typename V>
+inline V perlinNoise2D(V x, V z, typename V::Int seed) {
+    V fx = floorv(x), fz = floorv(z);
+    V sum = surflet(x, z, fx, fz, seed);
+    sum = sum + surflet(x, z, fx, fz + V(1.f), seed);
+    sum = sum + surflet(x, z, fx + V(1.f), fz, seed);
+    sum = sum + surflet(x, z, fx + V(1.f), fz + V(1.f), seed);
+    return sum;
+}
+
+template <typename V>
+inline V fractalNoise2D(V x, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    V value(0.f);
+    for (int i = 0; i < NoiseOctaves::COUNT; i++) {
+        V scale(octaves.scale[i]);
+        value = value + perlinNoise2D(x * scale, z * scale, seed) * V(octaves.atten[i]);
+    }
+    return value;
+}
+
+template <typename V>
+inline V worleyNoise2D(V x, V z, typename V::Int seed) {
+    V ix = truncv(x);
+    V iz = truncv(z);
+    V fracX = x - ix;
+    // Offsets by x, not z; the terrain has always been shaped this way
+    V fracZ = z - ix;
+
+    V minDist1(1.f);
+    V minDist2(1.f);
+
+    for (int i = -1; i < 2; i++) {
+        for (int j = -1; j < 2; j++) {
+            typename V::Int h = hash2D(toInt(ix + V(float(j))), toInt(iz + V(float(i))), seed);
+            V voronoiX = unitFloat(h);
+            V voronoiZ = unitFloat(mixHash(h));
+            V diffX = V(float(j)) + voronoiX - fracX;
+            V diffZ = V(float(i)) + voronoiZ - fracZ;
+            V dist = sqrtv(diffX * diffX + diffZ * diffZ);
+
+            auto closest = dist < minDist1;
+            minDist2 = select(closest, minDist1, select(dist < minDist2, dist, minDist2));
+            minDist1 = select(closest, dist, minDist1);
+        }
+    }
+
+    return minDist2 - minDist1;
+}
+
+template <typename V>
+inline V grasslandHeight(V x, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    V u = x / V(512.f), v = z / V(512.f);
+    V noise = worleyNoise2D(fractalNoise2D(u, v, octaves, seed), fractalNoise2D(v, u, octaves, seed), seed);
+    return V(128.f) + V(32.f) * noise;
+}
+
+template <typename V>
+inline V mountainHeight(V x, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    V noise = absv(fractalNoise2D(x / V(4096.f), z / V(4096.f), octaves, seed));
+    return V(160.f) + V(90.f) * noise;
+}
+
+template <typename V>
+inline V biomeNoise(V x, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    return (fractalNoise2D(x / V(2048.f), z / V(2048.f), octaves, seed) + V(1.f)) / V(2.f);
+}
+
+template <typename V>
+int heightNoise(const float *x, const float *z, int n,
+                const HeightNoiseOctaves &octaves, uint32_t seed,
+                float *grassland, float *mountain, float *perlin) {
+    typename V::Int s(seed);
+    int i = 0;
+    for (; i + V::WIDTH <= n; i += V::WIDTH) {
+        V vx = V::load(x + i), vz = V::load(z + i);
+        grasslandHeight(vx, vz, octaves.grassland, s).store(grassland + i);
+        mountainHeight(vx, vz, octaves.mountain, s).store(mountain + i);
+        biomeNoise(vx, vz, octaves.perlin, s).store(perlin + i);
+    }
+    return i;
+}
+
+template <typename V>
+inline V surflet3D(V px, V py, V pz, V gx, V gy, V gz, typename V::Int seed) {
+    V t = smootherFalloff(absv(px - gx)) * smootherFalloff(absv(py - gy)) * smootherFalloff(absv(pz - gz));
+
+    typename V::Int h = hash3D(toInt(gx), toInt(gy), toInt(gz), seed);
+    V rx = unitFloat(h);
+    h = mixHash(h);
+    V ry = unitFloat(h);
+    V rz = unitFloat(mixHash(h));
+    V gradX = (rx - V(0.5f)) * V(2.f) - V(1.f);
+    V gradY = (ry - V(0.5f)) * V(2.f) - V(1.f);
+    V gradZ = (rz - V(0.5f)) * V(2.f) - V(1.f);
+
+    return ((px - gx) * gradX + (py - gy) * gradY + (pz - gz) * gradZ) * t;
+}
+
+template <typename V>
+inline V perlinNoise3D(V x, V y, V z, typename V::Int seed) {
+    V fx = floorv(x), fy = floorv(y), fz = floorv(z);
+    V sum(0.f);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                sum = sum + surflet3D(x, y, z, fx + V(float(i)), fy + V(float(j)), fz + V(float(k)), seed);
+            }
+        }
+    }
+    return sum;
+}
+
+template <typename V>
+inline V fractalNoise3D(V x, V y, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    V value(0.f);
+    for (int i = 0; i < NoiseOctaves::COUNT; i++) {
+        V scale(octaves.scale[i]);
+        value = value + perlinNoise3D(x * scale, y * scale, z * scale, seed) * V(octaves.atten[i]);
+    }
+    return value;
+}
+
+template <typename V>
+inline V caveDensity(V x, V y, V z, const NoiseOctaves &octaves, typename V::Int seed) {
+    return fractalNoise3D(x / V(4096.f), y / V(4096.f), z / V(4096.f), octaves, seed);
+}
+
+template <typename V>
+int caveNoise(const float *x, const float *y, const float *z, int n,
+              const NoiseOctaves &octaves, uint32_t seed, float *density) {
+    typename V::Int s(seed);
+    int i = 0;
+    for (; i + V::WIDTH <= n; i += V::WIDTH) {
+        caveDensity(V::load(x + i), V::load(y + i), V::load(z + i), octaves, s).store(density + i);
+    }
+    return i;
+}
+
+} // namespace
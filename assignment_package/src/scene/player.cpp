@@ -1,4 +1,5 @@
 #include "player.h"
+#include "blockregistry.h"
 #include <QString>
 
 Player::Player(glm::vec3 pos, const Terrain &terrain)
@@ -151,7 +152,7 @@ void Player::computePhysics(float dT, const Terrain &terrain, InputBundle &input
 bool Player::isOnGround(const Terrain &terrain, InputBundle &inputs)
 {
 
-    if (terrain.getBlockAt(m_position) != EMPTY && terrain.getBlockAt(m_position) != WATER && terrain.getBlockAt(m_position) != LAVA)
+    if (blockInfo(terrain.getBlockAt(m_position)).solid)
     {
         inputs.onGround = true;
     }
@@ -210,10 +211,10 @@ bool Player::gridMarch(glm::vec3 rayOrigin,
         // Sets it to 0 if sign is +, -1 if sign is -
         offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
         currCell = glm::ivec3(glm::floor(rayOrigin)) + offset;
-        // If currCell contains something other than EMPTY, return
+        // If currCell contains a solid block, return
         // curr_t
         BlockType cellType = terrain.getBlockAt(currCell.x, currCell.y, currCell.z);
-        if(cellType != EMPTY && cellType != WATER && cellType != LAVA)
+        if(blockInfo(cellType).solid)
         {
             *out_blockHit = currCell;
             *out_dist = min(maxLen, curr_t);
@@ -344,18 +345,14 @@ BlockType Player::addBlock(Terrain *terrain, BlockType currBlockType)
         {
 
             terrain->setBlockAt(outBlockHit.x-1 , outBlockHit.y, outBlockHit.z, currBlockType);
-            terrain->getChunkAt(outBlockHit.x-1, outBlockHit.z).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x-1, outBlockHit.z).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x-1, outBlockHit.z).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x-1 , outBlockHit.y, outBlockHit.z);
             return currBlockType;
         }
         blockType = terrain->getBlockAt(outBlockHit.x+1 , outBlockHit.y, outBlockHit.z);
         if (blockType == EMPTY)
         {
             terrain->setBlockAt(outBlockHit.x+1 , outBlockHit.y, outBlockHit.z, currBlockType);
-            terrain->getChunkAt(outBlockHit.x+1, outBlockHit.z).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x+1, outBlockHit.z).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x+1, outBlockHit.z).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x+1 , outBlockHit.y, outBlockHit.z);
             return currBlockType;
         }
         // check up
@@ -363,18 +360,14 @@ BlockType Player::addBlock(Terrain *terrain, BlockType currBlockType)
         if (blockType == EMPTY)
         {
             terrain->setBlockAt(outBlockHit.x, outBlockHit.y-1, outBlockHit.z, currBlockType);
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x, outBlockHit.y-1, outBlockHit.z);
             return currBlockType;
         }
         blockType = terrain->getBlockAt(outBlockHit.x, outBlockHit.y+1, outBlockHit.z);
         if (blockType == EMPTY)
         {
             terrain->setBlockAt(outBlockHit.x, outBlockHit.y+1, outBlockHit.z, currBlockType);
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x, outBlockHit.y+1, outBlockHit.z);
             return currBlockType;
         }
         // check right
@@ -382,18 +375,14 @@ BlockType Player::addBlock(Terrain *terrain, BlockType currBlockType)
         if (blockType == EMPTY)
         {
             terrain->setBlockAt(outBlockHit.x, outBlockHit.y, outBlockHit.z-1, currBlockType);
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z-1).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z-1).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z-1).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x, outBlockHit.y, outBlockHit.z-1);
             return currBlockType;
         }
         blockType = terrain->getBlockAt(outBlockHit.x, outBlockHit.y, outBlockHit.z+1);
         if (blockType == EMPTY)
         {
             terrain->setBlockAt(outBlockHit.x, outBlockHit.y, outBlockHit.z+1, currBlockType);
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z+1).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z+1).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z+1).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x, outBlockHit.y, outBlockHit.z+1);
             return currBlockType;
         }
     }
@@ -410,12 +399,10 @@ BlockType Player::removeBlock(Terrain *terrain)
     if (gridMarch(rayOrigin, rayDirection, *terrain, &outDist, &outBlockHit))
     {
         BlockType blockType = terrain->getBlockAt(outBlockHit.x, outBlockHit.y, outBlockHit.z);
-        if (blockType != EMPTY && blockType != BEDROCK)
+        if (blockInfo(blockType).breakable)
         {
             terrain->setBlockAt(outBlockHit.x, outBlockHit.y, outBlockHit.z, EMPTY);
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->clear_VBO_data();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->createVBOdata();
-            terrain->getChunkAt(outBlockHit.x, outBlockHit.z).get()->sendVBO();
+            terrain->scheduleEditRemesh(outBlockHit.x, outBlockHit.y, outBlockHit.z);
         }
         return blockType;
     }
@@ -1,6 +1,15 @@
 #include "procedureterrain.h"
+#include "noisekernels.h"
 #include <glm_includes.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <vector>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
 
 ProcedureTerrain::ProcedureTerrain()
 {}
@@ -8,173 +17,316 @@ ProcedureTerrain::ProcedureTerrain()
 ProcedureTerrain::~ProcedureTerrain()
 {}
 
-int ProcedureTerrain::getHeight(int x, int z, int* isGrass) {
-    float grassland = grasslandCoord(x, z);
-    float mountain = mountainCoord(x, z);
+namespace {
 
-    float perlin = (fractalNoise2D(x / 2048.f, z / 2048.f, 0.2) + 1) / 2;
-    float smoothPerlin = glm::smoothstep(0.5, 0.6, (double) perlin);
-    if (smoothPerlin < 0.5) {
-        *isGrass = 1;
-    } else {
-        *isGrass = 0;
-    }
-    return glm::clamp(glm::mix(grassland, mountain, smoothPerlin), 0.f, 255.f);
-}
+struct U1 {
+    uint32_t v;
 
-float ProcedureTerrain::grasslandCoord(float x, float z) {
-    int grasslandLower = 128;
-    int grasslandUpper = 160;
+    U1(uint32_t u) : v(u) {}
+};
 
-    float noise = worleyNoise2D(fractalNoise2D(x / 512, z / 512, 0.5), fractalNoise2D(z / 512, x / 512, 0.5));
-    return grasslandLower + (grasslandUpper - grasslandLower) * noise;
+inline U1 operator*(U1 a, U1 b) { return U1(a.v * b.v); }
+inline U1 operator^(U1 a, U1 b) { return U1(a.v ^ b.v); }
+inline U1 operator>>(U1 a, int n) { return U1(a.v >> n); }
 
-}
+// One column at a time; the reference the SIMD lanes must match
+struct F1 {
+    static constexpr int WIDTH = 1;
+    using Mask = bool;
+    using Int = U1;
+    float v;
 
-float ProcedureTerrain::mountainCoord(float x, float z) {
-    int mountainLower = 160;
-    int mountainUpper = 250;
-
-    float noise = glm::abs(fractalNoise2D(x / 4096, z / 4096, 0.92));
+    F1(float f) : v(f) {}
+    static F1 load(const float *p) { return F1(*p); }
+    void store(float *p) const { *p = v; }
+};
 
-    return mountainLower + (mountainUpper - mountainLower) * noise;
+inline F1 operator+(F1 a, F1 b) { return F1(a.v + b.v); }
+inline F1 operator-(F1 a, F1 b) { return F1(a.v - b.v); }
+inline F1 operator*(F1 a, F1 b) { return F1(a.v * b.v); }
+inline F1 operator/(F1 a, F1 b) { return F1(a.v / b.v); }
+inline bool operator<(F1 a, F1 b) { return a.v < b.v; }
+inline bool operator>=(F1 a, F1 b) { return a.v >= b.v; }
+inline F1 floorv(F1 a) { return F1(std::floor(a.v)); }
+inline F1 truncv(F1 a) { return F1(std::trunc(a.v)); }
+inline F1 sqrtv(F1 a) { return F1(std::sqrt(a.v)); }
+inline F1 absv(F1 a) { return F1(std::fabs(a.v)); }
+// Out of range and NaN give 0x80000000, like cvttps2dq
+inline U1 toInt(F1 a) {
+    if (a.v >= -2147483648.f && a.v < 2147483648.f) {
+        return U1(uint32_t(int32_t(a.v)));
+    }
+    return U1(0x80000000u);
 }
+inline F1 unitFloat(U1 h) { return F1(float(int32_t((h >> 8).v)) * (1.f / 16777216.f)); }
+inline F1 select(bool m, F1 a, F1 b) { return m ? a : b; }
 
-float ProcedureTerrain::fractalNoise2D(float x, float z, float persistence) {
-    float value = 0.0;
+NoiseOctaves makeOctaves(float persistence) {
+    NoiseOctaves octaves;
     float scale = 1.0;
     float atten = 1.0;
-    int octaves = 7;
-
-    for (int i = 0; i < octaves; i++) {
+    for (int i = 0; i < NoiseOctaves::COUNT; i++) {
         scale *= 2.0;
         atten *= pow(persistence, i);
-        value += perlinNoise2D(glm::vec2(x * scale, z * scale)) * atten;
+        octaves.scale[i] = scale;
+        octaves.atten[i] = atten;
     }
-    return value;
+    return octaves;
 }
 
-glm::vec2 pow(glm::vec2 base, int power) {
-    glm::vec2 value = base;
-    value.x = pow(base.x, power);
-    value.y = pow(base.y, power);
-    return value;
+const HeightNoiseOctaves &heightOctaves() {
+    static const HeightNoiseOctaves octaves = {
+        makeOctaves(0.5), makeOctaves(0.92), makeOctaves(0.2)
+    };
+    return octaves;
 }
 
-float ProcedureTerrain::perlinNoise2D(glm::vec2 xz) {
-    float sum = 0.0;
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 2; j++) {
-            sum += surflets(xz, glm::floor(xz) + glm::vec2(i, j));
-        }
+bool cpuHasAvx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    // The OS must save the AVX registers (OSXSAVE, then XCR0 bits 1 and 2)
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) {
+        return false;
     }
-    return sum;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return false;
+#endif
 }
 
-float ProcedureTerrain::surflets(glm::vec2 point, glm::vec2 pointOnGrid) {
-    glm::vec2 d = glm::abs(point - pointOnGrid);
-    glm::vec2 t = glm::vec2(1.f) - 6.f * pow(d, 5) + 15.f * pow(d, 4) - 10.f * pow(d, 3);
-    glm::vec2 difference = point - pointOnGrid;
-
-    pointOnGrid += 0.1;
-    float x;
-    float y;
-    glm::mat2 primes;
-    primes = glm::mat2{{126.1, 311.7}, {420.2, 1337.1}};
-    x = 43758.5453;
-    y = 789221.5453;
-    glm::vec2 noise = glm::sin(pointOnGrid * primes);
-    noise.x *= x;
-    noise.y *= y;
-    glm::vec2 gradient = glm::normalize(glm::abs(glm::fract(noise))) * 2.f - glm::vec2(1,1);
-
-    float height = glm::dot(difference, gradient) * t.x * t.y;
-    return height;
+bool cpuHasSse41() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("sse4.1");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 19);
+#else
+    return false;
+#endif
 }
 
-float ProcedureTerrain::worleyNoise2D(float x, float z) {
-    int ix = int(x);
-    int iz = int(z);
-    float fracX = x - float(int(x));
-    float fracZ = z - float(int(x));
-
-    float minDist1 = 1;
-    float minDist2 = 1;
-
-    for (int i = -1; i < 2; i++) {
-        for (int j = -1; j < 2; j++) {
-            glm::vec2 neighborDirection = glm::vec2(j, i);
-            float voronoi_x = glm::fract(glm::sin(glm::dot(glm::vec2(ix, iz) + neighborDirection, glm::vec2(127.1, 311.7))) * 43758.5453);
-            float voronoi_z = glm::fract(glm::sin(glm::dot(glm::vec2(ix, iz) + neighborDirection, glm::vec2(420.2, 1337.1))) * 789221.1234);
-            glm::vec2 neighborVoronoiCenter =  glm::vec2(voronoi_x, voronoi_z);
-            glm::vec2 diff = neighborDirection + neighborVoronoiCenter - glm::vec2(fracX, fracZ);
-            float dist = glm::length(diff);
-            if (dist < minDist1) {
-                minDist2 = minDist1;
-                minDist1 = dist;
-            } else if (dist < minDist2) {
-                minDist2 = dist;
-            }
+struct NoiseKernelChoice {
+    HeightNoiseKernel height;
+    CaveNoiseKernel cave;
+    const char *name;
+};
+
+// The kernels both this build and this CPU support, widest first and
+// scalar last
+const std::vector<NoiseKernelChoice> &supportedKernels() {
+    static const std::vector<NoiseKernelChoice> kernels = [] {
+        std::vector<NoiseKernelChoice> k;
+        if (heightNoiseAvx2() && cpuHasAvx2()) {
+            k.push_back(NoiseKernelChoice{heightNoiseAvx2(), caveNoiseAvx2(), "avx2"});
+        }
+        if (heightNoiseSse41() && cpuHasSse41()) {
+            k.push_back(NoiseKernelChoice{heightNoiseSse41(), caveNoiseSse41(), "sse4.1"});
+        }
+        k.push_back(NoiseKernelChoice{nullptr, nullptr, "scalar"});
+        return k;
+    }();
+    return kernels;
+}
+
+// The kernels in use: the widest, unless setNoiseKernel chose another
+const NoiseKernelChoice *&currentKernel() {
+    static const NoiseKernelChoice *kernel = &supportedKernels().front();
+    return kernel;
+}
+
+// Evaluates the height noise at the width x depth points spaced step
+// blocks apart from (x, z), with the best kernel plus the scalar one for
+// the leftover columns
+void sampleHeightNoise(int x, int z, int width, int depth, int step,
+                       float *grassland, float *mountain, float *perlin) {
+    const int n = width * depth;
+    std::vector<float> coords(2 * n);
+    float *xs = coords.data(), *zs = xs + n;
+    for (int i = 0; i < width; i++) {
+        for (int j = 0; j < depth; j++) {
+            xs[i * depth + j] = x + i * step;
+            zs[i * depth + j] = z + j * step;
         }
     }
 
-    return minDist2 - minDist1;
+    const HeightNoiseOctaves &octaves = heightOctaves();
+    int done = 0;
+    HeightNoiseKernel kernel = currentKernel()->height;
+    if (ProcedureTerrain::simdNoise && kernel) {
+        done = kernel(xs, zs, n, octaves, ProcedureTerrain::seed, grassland, mountain, perlin);
+    }
+    heightNoise<F1>(xs + done, zs + done, n - done, octaves, ProcedureTerrain::seed,
+                    grassland + done, mountain + done, perlin + done);
 }
 
+int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
 
-float ProcedureTerrain::perlinNoise3D(glm::vec3 xyz) {
-    float surfletSum = 0.f;
-    for (int i = 0; i < 2; i++) {
-        for (int j = 0; j < 2; j++) {
-            for (int k = 0; k < 2; k++) {
-                surfletSum += surflet3D(xyz, glm::floor(xyz) + glm::vec3(i, j, k));
+// Interpolates the lattice cell whose lower corners are samples s00
+// and s10 (one lattice row apart in x)
+float bilinear(const float *samples, int s00, int s10, float tx, float tz) {
+    float low = samples[s00] * (1.f - tx) + samples[s10] * tx;
+    float high = samples[s00 + 1] * (1.f - tx) + samples[s10 + 1] * tx;
+    return low * (1.f - tz) + high * tz;
+}
+
+} // namespace
+
+uint32_t ProcedureTerrain::seed = 0;
+bool ProcedureTerrain::simdNoise = true;
+int ProcedureTerrain::heightSampleStep = 4;
+
+const char *ProcedureTerrain::noiseKernelName() {
+    return simdNoise ? currentKernel()->name : "scalar";
+}
+
+std::vector<const char*> ProcedureTerrain::noiseKernelNames() {
+    std::vector<const char*> names;
+    for (const NoiseKernelChoice &k : supportedKernels()) {
+        names.push_back(k.name);
+    }
+    return names;
+}
+
+bool ProcedureTerrain::setNoiseKernel(const char *name) {
+    for (const NoiseKernelChoice &k : supportedKernels()) {
+        if (std::strcmp(k.name, name) == 0) {
+            currentKernel() = &k;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProcedureTerrain::getHeights(int x, int z, int width, int depth, int *heights, int *isGrass) {
+    const int n = width * depth;
+    std::vector<float> noise(3 * n);
+    float *grassland = noise.data(), *mountain = grassland + n, *perlin = mountain + n;
+
+    const int step = std::max(1, heightSampleStep);
+    if (step == 1) {
+        sampleHeightNoise(x, z, width, depth, 1, grassland, mountain, perlin);
+    } else {
+        // The lattice points (multiples of step) around the area. Areas
+        // that share a border interpolate between the same samples, so
+        // chunks still line up.
+        int latticeX = floorDiv(x, step), latticeZ = floorDiv(z, step);
+        int latticeWidth = floorDiv(x + width - 1, step) - latticeX + 2;
+        int latticeDepth = floorDiv(z + depth - 1, step) - latticeZ + 2;
+        int m = latticeWidth * latticeDepth;
+        std::vector<float> samples(3 * m);
+        float *sampleGrass = samples.data(), *sampleMountain = sampleGrass + m, *samplePerlin = sampleMountain + m;
+        sampleHeightNoise(latticeX * step, latticeZ * step, latticeWidth, latticeDepth, step,
+                          sampleGrass, sampleMountain, samplePerlin);
+
+        for (int i = 0; i < width; i++) {
+            int cellX = floorDiv(x + i, step);
+            float tx = float(x + i - cellX * step) / step;
+            cellX -= latticeX;
+            for (int j = 0; j < depth; j++) {
+                int cellZ = floorDiv(z + j, step);
+                float tz = float(z + j - cellZ * step) / step;
+                cellZ -= latticeZ;
+
+                int s00 = cellX * latticeDepth + cellZ;
+                int s10 = s00 + latticeDepth;
+                int idx = i * depth + j;
+                grassland[idx] = bilinear(sampleGrass, s00, s10, tx, tz);
+                mountain[idx] = bilinear(sampleMountain, s00, s10, tx, tz);
+                perlin[idx] = bilinear(samplePerlin, s00, s10, tx, tz);
             }
         }
     }
-    return surfletSum;
+
+    for (int i = 0; i < n; i++) {
+        float smoothPerlin = glm::smoothstep(0.5, 0.6, (double) perlin[i]);
+        if (smoothPerlin < 0.5) {
+            isGrass[i] = 1;
+        } else {
+            isGrass[i] = 0;
+        }
+        heights[i] = glm::clamp(glm::mix(grassland[i], mountain[i], smoothPerlin), 0.f, 255.f);
+    }
 }
 
-glm::vec3 pow3D(glm::vec3 base, int power) {
-    glm::vec3 value = base;
-    value.x = pow(base.x, power);
-    value.y = pow(base.y, power);
-    value.z = pow(base.z, power);
-    return value;
+uint32_t ProcedureTerrain::hashColumn(int x, int z, uint32_t salt) {
+    return hash2D(U1(uint32_t(x)), U1(uint32_t(z)), U1(seed ^ mixHash(U1(salt)).v)).v;
 }
 
-glm::vec3 random3(glm::vec3 pointOnGrid) {
-    float j = 4096.0 * sin(glm::dot(pointOnGrid, glm::vec3(17.0, 59.4, 15.0)));
-    glm::vec3 r;
-    r.z = glm::fract(512.0 * j);
-    j *= .125;
-    r.x = glm::fract(512.0 * j);
-    j *= .125;
-    r.y = glm::fract(512.0 * j);
-    r = r - glm::vec3(0.5);
-    return r;
+int ProcedureTerrain::getHeight(int x, int z, int* isGrass) {
+    int height;
+    getHeights(x, z, 1, 1, &height, isGrass);
+    return height;
 }
 
-float ProcedureTerrain::fractalNoise3D(glm::vec3 xyz, float persistence) {
-    float value = 0.0;
-    float scale = 1.0;
-    float atten = 1.0;
-    int octaves = 7;
+float ProcedureTerrain::grasslandCoord(float x, float z) {
+    return grasslandHeight(F1(x), F1(z), heightOctaves().grassland, seed).v;
+}
 
-    for (int i = 0; i < octaves; i++) {
-        scale *= 2.0;
-        atten *= pow(persistence, i);
-        value += perlinNoise3D(xyz * scale) * atten;
-    }
-    return value;
+float ProcedureTerrain::mountainCoord(float x, float z) {
+    return mountainHeight(F1(x), F1(z), heightOctaves().mountain, seed).v;
+}
+
+float ProcedureTerrain::fractalNoise2D(float x, float z, float persistence) {
+    return ::fractalNoise2D(F1(x), F1(z), makeOctaves(persistence), seed).v;
+}
+
+float ProcedureTerrain::perlinNoise2D(glm::vec2 xz) {
+    return ::perlinNoise2D(F1(xz.x), F1(xz.y), seed).v;
+}
+
+float ProcedureTerrain::surflets(glm::vec2 point, glm::vec2 pointOnGrid) {
+    return surflet(F1(point.x), F1(point.y), F1(pointOnGrid.x), F1(pointOnGrid.y), seed).v;
+}
+
+float ProcedureTerrain::worleyNoise2D(float x, float z) {
+    return ::worleyNoise2D(F1(x), F1(z), seed).v;
+}
+
+
+float ProcedureTerrain::perlinNoise3D(glm::vec3 xyz) {
+    return ::perlinNoise3D(F1(xyz.x), F1(xyz.y), F1(xyz.z), seed).v;
+}
+
+float ProcedureTerrain::fractalNoise3D(glm::vec3 xyz, float persistence) {
+    return ::fractalNoise3D(F1(xyz.x), F1(xyz.y), F1(xyz.z), makeOctaves(persistence), seed).v;
 }
 
 float ProcedureTerrain::surflet3D(glm::vec3 point, glm::vec3 pointOnGrid) {
-    glm::vec3 d = glm::abs(point - pointOnGrid);
-    glm::vec3 t = glm::vec3(1.f) - 6.f * pow3D(d, 5) + 15.f * pow3D(d, 4) - 10.f * pow3D(d, 3);
+    return ::surflet3D(F1(point.x), F1(point.y), F1(point.z),
+                       F1(pointOnGrid.x), F1(pointOnGrid.y), F1(pointOnGrid.z), seed).v;
+}
 
-    glm::vec3 difference = point - pointOnGrid;
-    glm::vec3 gradient = random3(pointOnGrid) * 2.f - glm::vec3(1.f, 1.f, 1.f);
-    float height = glm::dot(difference, gradient) * t.x * t.y * t.z;
+void ProcedureTerrain::getCaveDensities(glm::ivec3 origin, glm::ivec3 count, glm::ivec3 step, float* density) {
+    const int n = count.x * count.y * count.z;
+    std::vector<float> coords(3 * n);
+    float *xs = coords.data(), *ys = xs + n, *zs = ys + n;
+    for (int i = 0; i < count.x; i++) {
+        for (int j = 0; j < count.z; j++) {
+            for (int k = 0; k < count.y; k++) {
+                int idx = (i * count.z + j) * count.y + k;
+                xs[idx] = origin.x + i * step.x;
+                ys[idx] = origin.y + k * step.y;
+                zs[idx] = origin.z + j * step.z;
+            }
+        }
+    }
 
-    return height;
+    static const NoiseOctaves octaves = makeOctaves(10);
+    int done = 0;
+    CaveNoiseKernel kernel = currentKernel()->cave;
+    if (simdNoise && kernel) {
+        done = kernel(xs, ys, zs, n, octaves, seed, density);
+    }
+    caveNoise<F1>(xs + done, ys + done, zs + done, n - done, octaves, seed, density + done);
 }
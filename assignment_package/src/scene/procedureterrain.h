@@ -2,6 +2,8 @@
 #define PROCEDURETERRAIN_H
 
 #include <glm_includes.h>
+#include <cstdint>
+#include <vector>
 
 class ProcedureTerrain {
 public:
@@ -9,7 +11,38 @@ public:
     ProcedureTerrain();
     ~ProcedureTerrain();
 
+    // The world seed all noise gradients and hashColumn depend on. The
+    // same seed always generates the same world, on any thread or
+    // platform. Set it before generating any chunks.
+    static uint32_t seed;
+    // A well-mixed hash of a world column and the seed, for placing
+    // features. Different salts give unrelated hashes.
+    static uint32_t hashColumn(int x, int z, uint32_t salt);
+
     static int getHeight(int x, int z, int* isGrass);
+    // getHeight for each column of the width x depth area whose lower-left
+    // corner is (x, z), with the SIMD kernels when the CPU has them.
+    // Column (x + i, z + j) goes to heights[i * depth + j] and
+    // isGrass[i * depth + j]. Results are identical to getHeight.
+    static void getHeights(int x, int z, int width, int depth, int* heights, int* isGrass);
+    // Quality knob for getHeight(s): the noise is only evaluated every
+    // heightSampleStep blocks in x and z, on a lattice fixed in world
+    // space, and bilinearly interpolated in between. 1 evaluates every
+    // column; 4 (the default) needs about 16x fewer evaluations and
+    // stays within a couple of blocks of it (terrainbench --verify).
+    static int heightSampleStep;
+    // Set to false to compute heights with the scalar kernel only
+    static bool simdNoise;
+    // "avx2", "sse4.1" or "scalar": the kernel getHeights uses
+    static const char* noiseKernelName();
+    // The names of the kernels both this build and this CPU support,
+    // widest first; "scalar" is always last
+    static std::vector<const char*> noiseKernelNames();
+    // Uses the named kernel from now on instead of the widest one.
+    // Returns false, changing nothing, if it is not supported. Call it
+    // before generating any chunks.
+    static bool setNoiseKernel(const char* name);
+
     static float grasslandCoord(float x, float z);
     static float mountainCoord(float x, float z);
     static float fractalNoise2D(float x, float z, float persistence);
@@ -17,6 +50,13 @@ public:
     static float surflets(glm::vec2 point, glm::vec2 pointOnGrid);
     static float worleyNoise2D(float x, float z);
 
+    // The cave density fractalNoise3D(p / 4096, 10) at each point p of a
+    // count.x x count.y x count.z lattice spaced step blocks apart from
+    // origin, with the SIMD kernels when the CPU has them. Point
+    // (i, k, j) (k along y) goes to density[(i * count.z + j) * count.y + k].
+    // Caves are where the density is negative.
+    static void getCaveDensities(glm::ivec3 origin, glm::ivec3 count, glm::ivec3 step, float* density);
+
     static float perlinNoise3D(glm::vec3 xyz);
     static float surflet3D(glm::vec3 point, glm::vec3 pointOnGrid);
     static float fractalNoise3D(glm::vec3 xyz, float persistence);
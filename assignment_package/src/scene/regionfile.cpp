@@ -0,0 +1,165 @@
+#include "regionfile.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static void putU32(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t *p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+RegionFile::RegionFile(const std::string &path)
+    : m_file(std::fopen(path.c_str(), "r+b")), m_path(path), m_table(), m_used(HEADER_SECTORS, true)
+{
+    std::vector<uint8_t> header(HEADER_SECTORS * SECTOR_SIZE, 0);
+    if (m_file == nullptr) {
+        // A new region: just the header, with every chunk unsaved
+        m_file = std::fopen(path.c_str(), "w+b");
+        if (m_file == nullptr) {
+            throw std::runtime_error("Cannot create region file " + path);
+        }
+        std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+        if (std::fwrite(header.data(), 1, header.size(), m_file) != header.size()) {
+            std::fclose(m_file);
+            throw std::runtime_error("Cannot write region file " + path);
+        }
+        return;
+    }
+
+    if (std::fread(header.data(), 1, HEADER_SIZE, m_file) != HEADER_SIZE ||
+            std::memcmp(header.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        std::fclose(m_file);
+        throw std::runtime_error(path + " is not a region file");
+    }
+    if (std::fseek(m_file, 0, SEEK_END) != 0) {
+        std::fclose(m_file);
+        throw std::runtime_error("Cannot seek in region file " + path);
+    }
+    long fileSize = std::ftell(m_file);
+    for (int i = 0; i < CHUNKS * CHUNKS; i++) {
+        const uint8_t *p = header.data() + sizeof(MAGIC) + i * 8;
+        m_table[i].sector = getU32(p);
+        m_table[i].length = getU32(p + 4);
+        if (m_table[i].length == 0) {
+            continue;
+        }
+        // The data has to lie between the header and the end of the file
+        uint64_t endSector = uint64_t(m_table[i].sector) + sectorsFor(m_table[i].length);
+        if (m_table[i].sector < HEADER_SECTORS || fileSize < 0 ||
+                endSector * SECTOR_SIZE > static_cast<uint64_t>(fileSize)) {
+            std::fclose(m_file);
+            throw std::runtime_error(path + " is not a region file");
+        }
+        markUsed(m_table[i].sector, sectorsFor(m_table[i].length), true);
+    }
+}
+
+RegionFile::~RegionFile() {
+    std::fclose(m_file);
+}
+
+uint32_t RegionFile::sectorsFor(uint32_t length) {
+    return static_cast<uint32_t>((length + SECTOR_SIZE - 1) / SECTOR_SIZE);
+}
+
+void RegionFile::markUsed(uint32_t sector, uint32_t count, bool used) {
+    if (m_used.size() < sector + count) {
+        m_used.resize(sector + count, false);
+    }
+    std::fill(m_used.begin() + sector, m_used.begin() + sector + count, used);
+}
+
+uint32_t RegionFile::allocate(uint32_t count) {
+    uint32_t run = 0;
+    for (uint32_t s = HEADER_SECTORS; s < m_used.size(); s++) {
+        run = m_used[s] ? 0 : run + 1;
+        if (run == count) {
+            return s + 1 - count;
+        }
+    }
+    // Extend a free run at the end of the file
+    return static_cast<uint32_t>(m_used.size()) - run;
+}
+
+void RegionFile::seek(std::size_t offset) {
+    if (std::fseek(m_file, static_cast<long>(offset), SEEK_SET) != 0) {
+        throw std::runtime_error("Cannot seek in region file " + m_path);
+    }
+}
+
+void RegionFile::writeEntry(int index) {
+    uint8_t entry[8];
+    putU32(entry, m_table[index].sector);
+    putU32(entry + 4, m_table[index].length);
+    seek(sizeof(MAGIC) + index * 8);
+    if (std::fwrite(entry, 1, sizeof(entry), m_file) != sizeof(entry)) {
+        throw std::runtime_error("Cannot write region file " + m_path);
+    }
+}
+
+bool RegionFile::read(int localX, int localZ, std::vector<uint8_t> *data) {
+    const Entry &e = m_table.at(localX * CHUNKS + localZ);
+    if (e.length == 0) {
+        return false;
+    }
+    data->resize(e.length);
+    seek(e.sector * SECTOR_SIZE);
+    if (std::fread(data->data(), 1, e.length, m_file) != e.length) {
+        throw std::runtime_error("Truncated chunk in region file " + m_path);
+    }
+    return true;
+}
+
+bool RegionFile::contains(int localX, int localZ) const {
+    return m_table.at(localX * CHUNKS + localZ).length > 0;
+}
+
+void RegionFile::write(int localX, int localZ, const std::vector<uint8_t> &data) {
+    int index = localX * CHUNKS + localZ;
+    Entry &e = m_table.at(index);
+    uint32_t length = static_cast<uint32_t>(data.size());
+    uint32_t count = sectorsFor(length);
+
+    if (e.length == 0 || sectorsFor(e.length) < count) {
+        if (e.length > 0) {
+            markUsed(e.sector, sectorsFor(e.length), false);
+        }
+        e.sector = allocate(count);
+        markUsed(e.sector, count, true);
+    } else if (sectorsFor(e.length) > count) {
+        // Shrank; give back the sectors it no longer needs
+        markUsed(e.sector + count, sectorsFor(e.length) - count, false);
+    }
+    e.length = length;
+
+    // Pad to whole sectors so the file always ends on a sector boundary
+    std::vector<uint8_t> padded(data);
+    padded.resize(count * SECTOR_SIZE, 0);
+    seek(e.sector * SECTOR_SIZE);
+    if (std::fwrite(padded.data(), 1, padded.size(), m_file) != padded.size()) {
+        throw std::runtime_error("Cannot write region file " + m_path);
+    }
+    writeEntry(index);
+}
+
+void RegionFile::erase(int localX, int localZ) {
+    int index = localX * CHUNKS + localZ;
+    Entry &e = m_table.at(index);
+    if (e.length == 0) {
+        return;
+    }
+    markUsed(e.sector, sectorsFor(e.length), false);
+    e.sector = 0;
+    e.length = 0;
+    writeEntry(index);
+}
+
+void RegionFile::flush() {
+    std::fflush(m_file);
+}
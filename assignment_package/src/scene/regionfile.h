@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// One file of a saved world, holding the serialized blocks of up to
+// 32 x 32 chunks.
+//
+// The file starts with an 8-byte magic number and a table with one
+// entry per chunk: the first SECTOR_SIZE-byte sector of its data and
+// the length of the data in bytes (0 if the chunk was never saved).
+// A chunk's data fills whole sectors, so rewriting a chunk that did
+// not grow past its sectors overwrites it in place; otherwise it moves
+// to the first run of free sectors large enough, or to the end of the
+// file. All numbers are little-endian.
+//
+// Not thread-safe; WorldSave serializes access.
+class RegionFile {
+public:
+    static constexpr int CHUNKS = 32;
+    // Small enough that a chunk saved as a handful of edits
+    // (WorldSave::deltaSaves) does not take a page of disk
+    static constexpr std::size_t SECTOR_SIZE = 512;
+
+    // Opens the region file at path, creating it if it does not exist.
+    // Throws std::runtime_error if it cannot be opened or is not a
+    // region file.
+    explicit RegionFile(const std::string &path);
+    ~RegionFile();
+
+    RegionFile(const RegionFile&) = delete;
+    RegionFile &operator=(const RegionFile&) = delete;
+
+    // Reads the data of the chunk at (localX, localZ), each in
+    // [0, CHUNKS), into data. Returns false if it was never saved.
+    bool read(int localX, int localZ, std::vector<uint8_t> *data);
+    // Whether the chunk at (localX, localZ) was saved
+    bool contains(int localX, int localZ) const;
+    // Writes the data of the chunk at (localX, localZ). data must not
+    // be empty.
+    void write(int localX, int localZ, const std::vector<uint8_t> &data);
+    // Frees the data of the chunk at (localX, localZ), as if it had
+    // never been saved
+    void erase(int localX, int localZ);
+    // Pushes buffered writes to the operating system
+    void flush();
+
+private:
+    struct Entry {
+        uint32_t sector = 0;
+        uint32_t length = 0;
+    };
+
+    std::FILE *m_file;
+    std::string m_path;
+    std::array<Entry, CHUNKS * CHUNKS> m_table;
+    // Which sectors of the file hold a header or chunk data
+    std::vector<bool> m_used;
+
+    static constexpr char MAGIC[8] = {'M', 'M', 'R', 'E', 'G', 'I', 'O', 'N'};
+    static constexpr std::size_t HEADER_SIZE = sizeof(MAGIC) + CHUNKS * CHUNKS * 8;
+    static constexpr uint32_t HEADER_SECTORS = (HEADER_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    static uint32_t sectorsFor(uint32_t length);
+    // Returns the first sector of a run of count free sectors, growing
+    // the file if there is none
+    uint32_t allocate(uint32_t count);
+    void markUsed(uint32_t sector, uint32_t count, bool used);
+    void writeEntry(int index);
+    void seek(std::size_t offset);
+};
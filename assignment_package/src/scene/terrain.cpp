@@ -1,14 +1,58 @@
 #include "terrain.h"
 #include "cube.h"
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <scene/procedureterrain.h>
+#include "terraingenerator.h"
 
-Terrain::Terrain(OpenGLContext *context)
-    : m_chunks(), m_generatedTerrain(), m_geomCube(context), mp_context(context), mp_texture(nullptr)
+Terrain::Terrain(OpenGLContext *context, FrameScheduler *scheduler)
+    : m_chunks(), m_generatedTerrain(), m_zoneLastUsed(), m_tickCount(0),
+      m_memoryBudget(DEFAULT_MEMORY_BUDGET), m_memoryUsage(0), m_geomCube(context), mp_context(context), mp_scheduler(scheduler), mp_texture(nullptr),
+      m_quadIndices(context), m_chunksDrawn(0), m_chunksCulled(0), mp_save(nullptr), m_snapshotSeconds(0.0), m_workers()
 {}
 
 Terrain::~Terrain() {
+    // Chunks still being generated are dropped; they were never edited
+    saveDirtyChunks();
+    // MyGL's destructor made the context current
+    m_quadIndices.destroy();
+}
+
+void Terrain::openWorld(const std::string &dir) {
+    mp_save = mkU<WorldSave>(dir);
+    uint32_t seed;
+    if (mp_save->readSeed(&seed)) {
+        ProcedureTerrain::seed = seed;
+    } else {
+        mp_save->writeSeed(ProcedureTerrain::seed);
+    }
+}
+
+int Terrain::saveDirtyChunks() {
+    if (mp_save == nullptr) {
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    int dirty = 0;
+    for (auto & [ key, chunk ] : m_chunks) {
+        if (chunk->isDirty()) {
+            mp_save->save(toCoords(key), chunk->snapshot());
+            chunk->setDirty(false);
+            dirty++;
+        }
+    }
+    m_snapshotSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return dirty;
+}
+
+double Terrain::lastSnapshotSeconds() const {
+    return m_snapshotSeconds;
+}
+
+WorldSave *Terrain::worldSave() const {
+    return mp_save.get();
 }
 
 // Combine two 32-bit ints into one 64-bit int
@@ -103,10 +147,14 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
     if(hasChunkAt(x, z)) {
         uPtr<Chunk> &c = getChunkAt(x, z);
         glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
+        // May allocate a section, or copy one a snapshot still shares
+        std::size_t before = c->memoryUsage();
         c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
                       static_cast<unsigned int>(y),
                       static_cast<unsigned int>(z - chunkOrigin.y),
                       t);
+        m_memoryUsage = m_memoryUsage - before + c->memoryUsage();
+        c->setDirty(true);
     }
     else {
         throw std::out_of_range("Coordinates " + std::to_string(x) +
@@ -116,7 +164,7 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
 }
 
 Chunk* Terrain::instantiateChunkAt(int x, int z) {
-    uPtr<Chunk> chunk = mkU<Chunk>(mp_context);
+    uPtr<Chunk> chunk = mkU<Chunk>(mp_context, &m_quadIndices);
     Chunk *cPtr = chunk.get();
     m_chunks[toKey(x, z)] = move(chunk);
     // Set the neighbor pointers of itself and its neighbors
@@ -142,14 +190,35 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
 // When you make Chunk inherit from Drawable, change this code so
 // it draws each Chunk with the given ShaderProgram, remembering to set the
 // model matrix to the proper X and Z translation!
-void Terrain::draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram)
+void Terrain::draw(int minX, int maxX, int minZ, int maxZ, const glm::mat4 &viewProj, ShaderProgram *shaderProgram)
 {
+    Frustum frustum(viewProj);
+    std::vector<std::pair<glm::ivec2, Chunk*>> visible;
+    m_chunksDrawn = 0;
+    m_chunksCulled = 0;
+
     // Traverse trunks in range
-    BlockTypeMutex.lock();
     for(int x = minX; x < maxX; x += 16) {
         for(int z = minZ; z < maxZ; z += 16) {
             if (hasChunkAt(x, z)) {
                 const uPtr<Chunk> &chunk = getChunkAt(x, z);
+                // Still being meshed for the first time
+                if (!chunk->hasVBO()) {
+                    continue;
+                }
+                // Only the sections holding blocks are tested. Pad the
+                // box by a block so the animated water surface never
+                // pops in at the screen edges.
+                int minY, maxY;
+                if (!chunk->getNonEmptyRange(&minY, &maxY)) {
+                    continue;
+                }
+                if (!frustum.intersectsAABB(glm::vec3(x - 1, minY - 1, z - 1), glm::vec3(x + 17, maxY + 1, z + 17))) {
+                    m_chunksCulled++;
+                    continue;
+                }
+                m_chunksDrawn++;
+                visible.push_back({glm::ivec2(x, z), chunk.get()});
 
                 shaderProgram->setModelMatrix(glm::translate(glm::mat4(1.f), glm::vec3(x, 0.f, z)));
                 shaderProgram->draw_interleaved(*chunk, 0);
@@ -157,18 +226,55 @@ void Terrain::draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shader
         }
     }
 
-    // Traverse transparent trunks in range
-    for(int x = minX; x < maxX; x += 16) {
-        for(int z = minZ; z < maxZ; z += 16) {
-            if (hasChunkAt(x, z)) {
-                const uPtr<Chunk> &chunk = getChunkAt(x, z);
+    // Traverse transparent trunks that passed the frustum test
+    for(const auto &v : visible) {
+        shaderProgram->setModelMatrix(glm::translate(glm::mat4(1.f), glm::vec3(v.first.x, 0.f, v.first.y)));
+        shaderProgram->draw_interleaved_transparent(*v.second, 0);
+    }
+}
 
-                shaderProgram->setModelMatrix(glm::translate(glm::mat4(1.f), glm::vec3(x, 0.f, z)));
-                shaderProgram->draw_interleaved_transparent(*chunk, 0);
-            }
-        }
+void Terrain::scheduleEditRemesh(int x, int y, int z)
+{
+    int chunkX = 16 * static_cast<int>(glm::floor(x / 16.f));
+    int chunkZ = 16 * static_cast<int>(glm::floor(z / 16.f));
+    int s = y / 16;
+    uint16_t section = static_cast<uint16_t>(1 << s);
+    // The faces between this block and the ones above and below it
+    // belong to the sections of those blocks too
+    uint16_t sections = section;
+    if (y % 16 == 0 && s > 0) {
+        sections |= section >> 1;
+    } else if (y % 16 == 15 && s < 15) {
+        sections |= section << 1;
+    }
+    m_editedSections[toKey(chunkX, chunkZ)] |= sections;
+
+    if (x - chunkX == 0) {
+        m_editedSections[toKey(chunkX - 16, chunkZ)] |= section;
+    } else if (x - chunkX == 15) {
+        m_editedSections[toKey(chunkX + 16, chunkZ)] |= section;
+    }
+    if (z - chunkZ == 0) {
+        m_editedSections[toKey(chunkX, chunkZ - 16)] |= section;
+    } else if (z - chunkZ == 15) {
+        m_editedSections[toKey(chunkX, chunkZ + 16)] |= section;
     }
-    BlockTypeMutex.unlock();
+}
+
+void Terrain::setMemoryBudget(std::size_t bytes) {
+    m_memoryBudget = bytes;
+}
+
+std::size_t Terrain::memoryUsage() const {
+    return m_memoryUsage;
+}
+
+int Terrain::chunksDrawn() const {
+    return m_chunksDrawn;
+}
+
+int Terrain::chunksCulled() const {
+    return m_chunksCulled;
 }
 
 void Terrain::CreateTestScene()
@@ -199,7 +305,7 @@ void Terrain::CreateTestScene()
         int chunk_x = coordinates[i].x;
         int chunk_z = coordinates[i].y;
 
-        createBlocks(chunk_x, chunk_z, chunk);
+        TerrainGenerator::createBlocks(chunk_x, chunk_z, chunk);
      }
 
     // Generate VBOs
@@ -208,73 +314,77 @@ void Terrain::CreateTestScene()
         auto &chunk = chunkList[i];
         chunk->createVBOdata();
         chunk->sendVBO();
-    }
-}
-
-BlockType Terrain::generateBlockByHeight(int height, int maxHeight, int isGrass, int cur_x, int cur_z) {
-    if (height == 0) {
-        return BEDROCK;
-    } else if (height <= 128) {
-//        if (height < 50) {
-//            float caveParameter = ProcedureTerrain::fractalNoise3D(glm::vec3(cur_x, height, cur_z) / 4096.f, 10);
-//            if (caveParameter < 0) {
-//                if (height < 25) {
-//                    return LAVA;
-//                } else {
-//                    return EMPTY;
-//                }
-//            }
-//        }
-        return STONE;
-    } else {
-        if (isGrass) {
-            if (height == maxHeight) {
-                return GRASS;
-            } else {
-                return DIRT;
-            }
-        } else {
-            if (maxHeight <= 200) {
-                return STONE;
-            } else {
-                if (height == maxHeight) {
-                    return SNOW;
-                } else {
-                    return STONE;
-                }
-            }
-        }
+        m_memoryUsage += chunk->memoryUsage();
     }
 }
 
 // MM2
 uPtr<Chunk> Terrain::instantiateChunkAt0(int x, int z)
 {
-    uPtr<Chunk> chunk = mkU<Chunk>(mp_context);
+    uPtr<Chunk> chunk = mkU<Chunk>(mp_context, &m_quadIndices);
     Chunk *cPtr = chunk.get();
     // MM2
     cPtr->setChunkPos(x, z);
 
     return chunk;
 }
-void Terrain::VBOWorker(uPtr<Chunk> chunk)
+void Terrain::VBOWorker(Chunk *chunk, int version, uint16_t sections, const MeshSnapshot &blocks)
 {
-    chunk->createVBOdata();
+    // Only the snapshot is read; the chunk may be edited meanwhile
+    ChunkVBOData data = blocks.chunk->buildVBOdata(sections);
+    data.chunk = chunk;
+    data.version = version;
     VBOMutex.lock();
-    VBOChunks[toKey(chunk->getChunkPos().x, chunk->getChunkPos().y)] = move(chunk);
+    VBOChunks.push_back(std::move(data));
     VBOMutex.unlock();
 }
+void Terrain::requestMesh(Chunk *chunk, int priority, uint16_t sections)
+{
+    int version = chunk->requestMesh(sections);
+    // An older job still in flight is discarded, so this one also
+    // rebuilds whatever that one would have
+    uint16_t stale = chunk->staleSections();
+    chunk->beginMeshJob();
+    m_workers.submit(priority, [this, chunk, version, stale, blocks = chunk->meshSnapshot()]() {
+        VBOWorker(chunk, version, stale, blocks);
+    });
+}
 void Terrain::BlockTypeWorker(uPtr<Chunk> chunk)
 {
     glm::ivec2 chunkPos = chunk->getChunkPos();
 
-    // Create the basic terrain floor
-    createBlocks(chunkPos.x, chunkPos.y, chunk.get());
+    // Saved chunks are much cheaper to read back than to generate
+    if (mp_save == nullptr || !mp_save->load(chunkPos, chunk.get()))
+    {
+        // Create the basic terrain floor
+        TerrainGenerator::createBlocks(chunkPos.x, chunkPos.y, chunk.get());
+        // Saved in full so it loads faster next time, unless only edits are saved
+        chunk->setDirty(!WorldSave::deltaSaves);
+    }
 
     BlockTypeMutex.lock();
     BlockTypeChunks[toKey(chunk->getChunkPos().x, chunk->getChunkPos().y)] = move(chunk);
     BlockTypeMutex.unlock();
 }
+int Terrain::jobPriority(glm::ivec2 chunkPos, glm::vec3 playerPos)
+{
+    glm::ivec2 d = chunkPos / 16 - glm::ivec2(glm::floor(glm::vec2(playerPos.x, playerPos.z) / 16.f));
+    return d.x * d.x + d.y * d.y;
+}
+bool Terrain::hasPendingNeighbor(glm::ivec2 chunkPos) const
+{
+    const glm::ivec2 offsets[4] = {glm::ivec2(16, 0), glm::ivec2(-16, 0), glm::ivec2(0, 16), glm::ivec2(0, -16)};
+    for (glm::ivec2 offset : offsets)
+    {
+        glm::ivec2 n = chunkPos + offset;
+        glm::ivec2 zone = 64 * glm::ivec2(glm::floor(glm::vec2(n) / 64.f));
+        if (hasZoneAt(zone) && !hasChunkAt(n.x, n.y))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 bool Terrain::hasZoneAt(glm::ivec2 zonePos) const
 {
     return m_generatedTerrain.find(toKey(zonePos.x, zonePos.y)) != m_generatedTerrain.end();
@@ -317,19 +427,6 @@ std::vector<glm::ivec2> Terrain::diffVectors(std::vector<glm::ivec2> a,
 
     return diff;
 }
-bool Terrain::hasNewChunkAt(int x, int z) const
-{
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return newChunks.find(toKey(16 * xFloor, 16 * zFloor)) != newChunks.end();
-}
-uPtr<Chunk>& Terrain::getNewChunkAt(int x, int z)
-{
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-
-    return newChunks[toKey(16 * xFloor, 16 * zFloor)];
-}
 void Terrain::expandZone(glm::vec3 currPlayerPos, glm::vec3 prevPlayerPos)
 {
     glm::ivec2 currZone = glm::ivec2(glm::floor(currPlayerPos.x / 64.f) * 64.f,
@@ -352,153 +449,186 @@ void Terrain::expandZone(glm::vec3 currPlayerPos, glm::vec3 prevPlayerPos)
             {
                 for (int z = 0; z < 64; z += 16)
                 {
-                    newChunks[toKey(newZone.x + x, newZone.y + z)] = instantiateChunkAt0(newZone.x + x, newZone.y + z);
+                    // The chunk itself is allocated on the worker too
+                    glm::ivec2 chunkPos(newZone.x + x, newZone.y + z);
+                    m_workers.submit(jobPriority(chunkPos, currPlayerPos), [this, chunkPos]() {
+                        BlockTypeWorker(instantiateChunkAt0(chunkPos.x, chunkPos.y));
+                    });
                 }
             }
         }
     }
 
-    for (auto & [ key, chunk ]: newChunks)
+    // Take ownership of every chunk whose blocks are done. Nothing here
+    // waits on the workers; chunks still generating are picked up on a
+    // later tick.
+    std::unordered_map<int64_t, uPtr<Chunk>> generatedChunks;
+    BlockTypeMutex.lock();
+    generatedChunks.swap(BlockTypeChunks);
+    BlockTypeMutex.unlock();
+
+    // A new chunk changes which border faces of its neighbors are
+    // visible, so they are meshed again along with it. A chunk with a
+    // neighbor still being generated waits for that neighbor instead
+    // of being meshed once per arriving neighbor.
+    std::unordered_set<Chunk*> remesh;
+    for (auto & [ key, chunk ] : generatedChunks)
     {
         int x = chunk->getChunkPos().x;
         int z = chunk->getChunkPos().y;
-
-        if (hasChunkAt(x, z + 16))
-        {
-            auto &chunkNorth = getChunkAt(x, z + 16);
-            chunk.get()->linkNeighbor(chunkNorth, ZPOS);
-        }
-        if (hasChunkAt(x, z - 16))
+        const std::pair<glm::ivec2, Direction> neighbors[4] = {
+            {glm::ivec2(x, z + 16), ZPOS},
+            {glm::ivec2(x, z - 16), ZNEG},
+            {glm::ivec2(x + 16, z), XPOS},
+            {glm::ivec2(x - 16, z), XNEG}
+        };
+        for (const auto &n : neighbors)
         {
-            auto &chunkSouth = getChunkAt(x, z - 16);
-            chunk.get()->linkNeighbor(chunkSouth, ZNEG);
-        }
-        if (hasChunkAt(x + 16, z))
-        {
-            auto &chunkEast = getChunkAt(x + 16, z);
-            chunk.get()->linkNeighbor(chunkEast, XPOS);
+            if (hasChunkAt(n.first.x, n.first.y))
+            {
+                uPtr<Chunk> &neighbor = getChunkAt(n.first.x, n.first.y);
+                chunk->linkNeighbor(neighbor, n.second);
+                remesh.insert(neighbor.get());
+            }
         }
-        if (hasChunkAt(x - 16, z))
+        remesh.insert(chunk.get());
+        m_memoryUsage += chunk->memoryUsage();
+        m_chunks[key] = move(chunk);
+    }
+    for (Chunk *chunk : remesh)
+    {
+        if (!hasPendingNeighbor(chunk->getChunkPos()))
         {
-            auto &chunkWest = getChunkAt(x - 16, z);
-            chunk.get()->linkNeighbor(chunkWest, XNEG);
+            requestMesh(chunk, jobPriority(chunk->getChunkPos(), currPlayerPos));
         }
+    }
 
-        if (hasNewChunkAt(x, z + 16))
-        {
-            auto &chunkNorth = getNewChunkAt(x, z + 16);
-            chunk.get()->linkNeighbor(chunkNorth, ZPOS);
-        }
-        if (hasNewChunkAt(x, z - 16))
-        {
-            auto &chunkSouth = getNewChunkAt(x, z - 16);
-            chunk.get()->linkNeighbor(chunkSouth, ZNEG);
-        }
-        if (hasNewChunkAt(x + 16, z))
+    // Edited sections, ahead of everything else. Edits to a chunk that
+    // has since been unloaded were saved with it.
+    for (auto & [ key, sections ] : m_editedSections)
+    {
+        auto it = m_chunks.find(key);
+        if (it != m_chunks.end())
         {
-            auto &chunkEast = getNewChunkAt(x + 16, z);
-            chunk.get()->linkNeighbor(chunkEast, XPOS);
+            requestMesh(it->second.get(), EDIT_PRIORITY, sections);
         }
-        if (hasNewChunkAt(x - 16, z))
+    }
+    m_editedSections.clear();
+
+    // Queue finished meshes for upload, skipping any made stale by a newer request
+    std::vector<ChunkVBOData> meshes;
+    VBOMutex.lock();
+    meshes.swap(VBOChunks);
+    VBOMutex.unlock();
+    for (ChunkVBOData &mesh : meshes)
+    {
+        if (mesh.version != mesh.chunk->meshVersion())
         {
-            auto &chunkWest = getNewChunkAt(x - 16, z);
-            chunk.get()->linkNeighbor(chunkWest, XNEG);
+            mesh.chunk->endMeshJob();
+            continue;
         }
+        std::size_t bytes = (mesh.vec_data.size() + mesh.vec_data_trans.size()) * sizeof(glm::uvec2);
+        // Only edits remesh part of a chunk; show them first
+        FrameScheduler::Kind kind = mesh.sections == ChunkBlocks::ALL_SECTIONS ? FrameScheduler::VBO_UPLOAD : FrameScheduler::EDIT_REMESH;
+        // Shared, since a scheduled task has to be copyable and the mesh is not
+        sPtr<ChunkVBOData> upload = mkS<ChunkVBOData>(std::move(mesh));
+        mp_scheduler->post(kind, [this, upload]() {
+            // Checked again, the chunk may have been edited while queued
+            Chunk *chunk = upload->chunk;
+            std::size_t before = chunk->memoryUsage();
+            if (chunk->setVBOdata(std::move(*upload)))
+            {
+                chunk->sendVBO();
+            }
+            m_memoryUsage = m_memoryUsage - before + chunk->memoryUsage();
+            chunk->endMeshJob();
+        }, bytes);
     }
 
-    for (auto & [ key, chunk ]: newChunks)
+    m_tickCount++;
+    for (glm::ivec2 zone : currSourrondingZones)
     {
-        BlockTypeThreads.push_back(std::thread(&Terrain::BlockTypeWorker, this, move(chunk)));
+        m_zoneLastUsed[toKey(zone.x, zone.y)] = m_tickCount;
     }
+    unloadZones(currSourrondingZones);
+    firstTick = false;
+}
 
-    newChunks.clear();
+void Terrain::unloadZones(const std::vector<glm::ivec2> &keepZones)
+{
+    if (m_memoryUsage <= m_memoryBudget)
+    {
+        return;
+    }
 
-    for (auto &BlockTypeThread : BlockTypeThreads)
+    // Least recently visited first
+    std::vector<std::pair<uint64_t, int64_t>> candidates;
+    for (int64_t key : m_generatedTerrain)
     {
-        if(BlockTypeThread.joinable())
+        glm::ivec2 zone = toCoords(key);
+        if (std::find(keepZones.begin(), keepZones.end(), zone) == keepZones.end())
         {
-//            std::cout << "joinable" << std::endl;
-            BlockTypeThread.join();
+            candidates.push_back({m_zoneLastUsed[key], key});
         }
     }
+    std::sort(candidates.begin(), candidates.end());
 
-
-    BlockTypeMutex.lock();
-    for (auto & [ key, chunk ] : BlockTypeChunks)
+    for (auto & [ lastUsed, key ] : candidates)
     {
-        VBOThreads.push_back(std::thread(&Terrain::VBOWorker, this, move(chunk)));
+        if (m_memoryUsage <= m_memoryBudget)
+        {
+            break;
+        }
+        glm::ivec2 zone = toCoords(key);
+        if (canUnloadZone(zone))
+        {
+            m_memoryUsage -= unloadZone(zone);
+        }
     }
-    BlockTypeChunks.clear();
-    BlockTypeMutex.unlock();
+}
 
-    VBOMutex.lock();
-    for (auto & [ key, chunk ] : VBOChunks)
+bool Terrain::canUnloadZone(glm::ivec2 zonePos) const
+{
+    for (int x = 0; x < 64; x += 16)
     {
-        chunk.get()->sendVBO();
-        m_chunks[key] = move(chunk);
+        for (int z = 0; z < 64; z += 16)
+        {
+            if (!hasChunkAt(zonePos.x + x, zonePos.y + z) ||
+                getChunkAt(zonePos.x + x, zonePos.y + z)->isInUse())
+            {
+                return false;
+            }
+        }
     }
-
-//    for (auto & [ key, chunk ] : VBOChunks)
-//    {
-//        chunk->update_neighbor_chunks();
-//    }
-    VBOChunks.clear();
-    VBOMutex.unlock();
-    firstTick = false;
+    return true;
 }
 
-void Terrain::createBlocks(int target_x, int target_z, Chunk* chunk) {
-    int biome = -1;
-    for (int x = 0; x < 16; ++x) {
-        for (int z = 0; z < 16; ++z) {
-            int height = ProcedureTerrain::getHeight(target_x + x, target_z + z, &biome);
-            if (height <= 138 && height >= 128) {
-                for (int w = height + 1; w <= 138; w++) {
-                    chunk->setBlockAt(x, w, z, WATER);
-                }
-            }
-            for (int k = 0; k <= height; k++) {
-                chunk->setBlockAt(x, k, z, generateBlockByHeight(k, height, biome, target_x + x, target_z + z));
-                if (rand() % 500 == 0) {
-                    if (height < 142 && (target_x > 333 || target_x < 305) && (target_z > 333 || target_z < 305) && chunk->getBlockAt(x, k, z) == GRASS && chunk->getBlockAt(x, k + 1, z) != WATER) {
-                        if (x < 12 && z < 12 && x > 4 && z > 4) {
-                            for (int y = height; y < height + 3; y++) {
-                                chunk->setBlockAt(x, y, z, WOOD);
-                            }
-                            for (int y = height + 3; y < height + 8; y++) {
-                                for (int i = x - 1; i <= x + 1; i++) {
-                                    for (int j = z - 1; j <= z + 1; j++) {
-                                        chunk->setBlockAt(i, y, j, LEAF);
-                                    }
-                                }
-                            }
-                            for (int y = height + 4; y < height + 5; y++) {
-                                for (int i = x - 2; i <= x + 2; i++) {
-                                    for (int j = z - 2; j <= z + 2; j++) {
-                                        chunk->setBlockAt(i, y, j, LEAF);
-                                    }
-                                }
-                            }
-                            for (int y = height + 5; y < height + 6; y++) {
-                                for (int i = x - 3; i <= x + 3; i++) {
-                                    for (int j = z - 3; j <= z + 3; j++) {
-                                        chunk->setBlockAt(i, y, j, LEAF);
-                                    }
-                                }
-                            }
-                            for (int y = height + 6; y < height + 7; y++) {
-                                for (int i = x - 2; i <= x + 2; i++) {
-                                    for (int j = z - 2; j <= z + 2; j++) {
-                                        chunk->setBlockAt(i, y, j, LEAF);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+std::size_t Terrain::unloadZone(glm::ivec2 zonePos)
+{
+    // Called from the tick, outside paintGL
+    mp_context->makeCurrent();
+
+    std::size_t bytes = 0;
+    for (int x = 0; x < 64; x += 16)
+    {
+        for (int z = 0; z < 64; z += 16)
+        {
+            int64_t key = toKey(zonePos.x + x, zonePos.y + z);
+            uPtr<Chunk> &chunk = m_chunks.at(key);
+            bytes += chunk->memoryUsage();
+            if (mp_save != nullptr && chunk->isDirty())
+            {
+                mp_save->save(glm::ivec2(zonePos.x + x, zonePos.y + z), chunk->snapshot());
             }
+            chunk->unlinkNeighbors();
+            chunk->destroyVBOdata();
+            m_chunks.erase(key);
         }
     }
+    int64_t key = toKey(zonePos.x, zonePos.y);
+    m_generatedTerrain.erase(key);
+    m_zoneLastUsed.erase(key);
+    return bytes;
 }
 
 void Terrain::create_texture(const char *textureFile) {
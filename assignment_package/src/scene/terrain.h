@@ -8,6 +8,10 @@
 #include "shaderprogram.h"
 #include "cube.h"
 #include "texture.h"
+#include "frustum.h"
+#include "threadpool.h"
+#include "framescheduler.h"
+#include "worldsave.h"
 #include "thread"
 #include "mutex"
 
@@ -42,9 +46,21 @@ private:
     // world to add more "terrain generation zone" IDs to this set.
     // While only the 3 x 3 collection of terrain generation zones
     // surrounding the Player should be rendered, the Chunks
-    // in the Terrain will never be deleted until the program is terminated.
+    // in the Terrain are kept until they use more memory than
+    // m_memoryBudget; then the least recently visited zones away from
+    // the Player are unloaded and removed from this set, so they are
+    // generated again when the Player comes back.
     std::unordered_set<int64_t> m_generatedTerrain;
 
+    // The expandZone call count at which each generated zone was last
+    // within range of the Player
+    std::unordered_map<int64_t, uint64_t> m_zoneLastUsed;
+    uint64_t m_tickCount;
+    std::size_t m_memoryBudget;
+    // Sum of memoryUsage() over m_chunks, kept up to date as chunks
+    // arrive, are edited, have meshes uploaded and are unloaded
+    std::size_t m_memoryUsage;
+
     // TODO: DELETE ALL REFERENCES TO m_geomCube AS YOU WILL NOT USE
     // IT IN YOUR FINAL PROGRAM!
     // The instance of a unit cube we can use to render any cube.
@@ -55,22 +71,59 @@ private:
     Cube m_geomCube;
 
     OpenGLContext* mp_context;
+    // Runs chunk uploads and edit remeshes on the main thread
+    FrameScheduler* mp_scheduler;
 
     std::unique_ptr<Texture> mp_texture;
 
+    // Quad indices drawn by every Chunk
+    QuadIndexBuffer m_quadIndices;
+
     // MM2
-    std::unordered_map<int64_t, uPtr<Chunk>> newChunks;
+    // Completion queues filled by the worker threads and drained by
+    // expandZone on the main thread: chunks whose blocks have been
+    // generated, and meshes ready to be uploaded
     std::unordered_map<int64_t, uPtr<Chunk>> BlockTypeChunks;
-    std::unordered_map<int64_t, uPtr<Chunk>> VBOChunks;
+    std::vector<ChunkVBOData> VBOChunks;
     std::mutex BlockTypeMutex;
     std::mutex VBOMutex;
-    std::mutex Mutex;
-    std::vector<std::thread> BlockTypeThreads;
-    std::vector<std::thread> VBOThreads;
     bool firstTick = true;
 
+    // Sections edited since the last expandZone, by chunk key
+    std::unordered_map<int64_t, uint16_t> m_editedSections;
+
+    // Number of chunks submitted / rejected by the frustum test
+    // during the most recent call to draw()
+    int m_chunksDrawn;
+    int m_chunksCulled;
+
+    // Where chunks are saved when they are unloaded and loaded from
+    // before being generated. nullptr until openWorld().
+    uPtr<WorldSave> mp_save;
+    // Main-thread time of the last saveDirtyChunks, in seconds
+    double m_snapshotSeconds;
+
+    // Runs BlockTypeWorker and VBOWorker jobs. Declared last so it is
+    // destroyed (and its threads joined) before anything a job touches.
+    ThreadPool m_workers;
+
+    // Jobs for chunks nearer the player run first
+    static int jobPriority(glm::ivec2 chunkPos, glm::vec3 playerPos);
+    // Remeshes of edited chunks run before any other queued job
+    static constexpr int EDIT_PRIORITY = -1;
+
+    // Unloads least recently used zones outside keepZones until the
+    // chunks fit in m_memoryBudget
+    void unloadZones(const std::vector<glm::ivec2> &keepZones);
+    // A zone can be unloaded once all of its chunks are generated and
+    // no worker is meshing them
+    bool canUnloadZone(glm::ivec2 zonePos) const;
+    // Frees every chunk of the zone, after saving the dirty ones, and
+    // forgets it was generated. Returns the number of bytes released.
+    std::size_t unloadZone(glm::ivec2 zonePos);
+
 public:
-    Terrain(OpenGLContext *context);
+    Terrain(OpenGLContext *context, FrameScheduler *scheduler);
     ~Terrain();
 
     // Instantiates a new Chunk and stores it in
@@ -94,11 +147,39 @@ public:
     // values) set the block at that point in space to the
     // given type.
     void setBlockAt(int x, int y, int z, BlockType t);
+    // Marks the sections whose faces the world-space block touches as
+    // needing a new mesh: its own section, the one above or below if
+    // the block lies on their boundary, and the section of a
+    // neighboring Chunk if the block lies on its border. The next
+    // expandZone remeshes them on the workers.
+    void scheduleEditRemesh(int x, int y, int z);
 
     // Draws every Chunk that falls within the bounding box
-    // described by the min and max coords, using the provided
-    // ShaderProgram
-    void draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram);
+    // described by the min and max coords and intersects the
+    // view frustum of viewProj, using the provided ShaderProgram
+    void draw(int minX, int maxX, int minZ, int maxZ, const glm::mat4 &viewProj, ShaderProgram *shaderProgram);
+    int chunksDrawn() const;
+    int chunksCulled() const;
+
+    // Bytes the loaded chunks may use before distant zones are unloaded
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 128 * 1024 * 1024;
+    void setMemoryBudget(std::size_t bytes);
+    // Bytes used by the loaded chunks
+    std::size_t memoryUsage() const;
+
+    // Saves chunks to the world in dir from now on, and loads chunks
+    // from it instead of generating them. Takes the world's seed, or
+    // saves the current ProcedureTerrain::seed for a new world.
+    // Call before the first expandZone.
+    void openWorld(const std::string &dir);
+    // Queues a copy-on-write snapshot of every loaded chunk that differs
+    // from its saved copy, and returns how many there were. The blocks
+    // are only copied when they are next edited, so this is cheap
+    // enough to call from the tick; WorldSave encodes and writes them.
+    int saveDirtyChunks();
+    double lastSnapshotSeconds() const;
+    // nullptr until openWorld()
+    WorldSave *worldSave() const;
 
     // Initializes the Chunks that store the 64 x 256 x 64 block scene you
     // see when the base code is run.
@@ -107,24 +188,23 @@ public:
     // Update terrain based on position of player if necessary
     void update_terrain(glm::vec3 player_pos);
 
-    // generate block type
-    BlockType generateBlockByHeight(int height, int maxHeight, int isGrass, int cur_x, int cur_z);
-
     // Create texture image
     void create_texture(const char *textureFile);
     // Bind texture image
     void bind_texture();
 
-    void createBlocks(int target_x, int target_z, Chunk* chunk);
-
     // MM2
     uPtr<Chunk> instantiateChunkAt0(int x, int z);
     void BlockTypeWorker(uPtr<Chunk> chunk);
-    void VBOWorker(uPtr<Chunk> chunk);
+    void VBOWorker(Chunk *chunk, int version, uint16_t sections, const MeshSnapshot &blocks);
+    // Queues a VBOWorker job that rebuilds the given sections of a Chunk
+    // in m_chunks, along with any others still waiting for a mesh
+    void requestMesh(Chunk *chunk, int priority, uint16_t sections = ChunkBlocks::ALL_SECTIONS);
     void expandZone(glm::vec3 currPlayerPos, glm::vec3 prevPlayerPos);
     bool hasZoneAt(glm::ivec2 zonePos) const;
+    // Is a horizontal neighbor of this chunk queued for generation
+    // but not yet in m_chunks?
+    bool hasPendingNeighbor(glm::ivec2 chunkPos) const;
     std::vector<glm::ivec2> diffVectors(std::vector<glm::ivec2> a, std::vector<glm::ivec2> b);
-    bool hasNewChunkAt(int x, int z) const;
     std::vector<glm::ivec2> getSurroundingZones(glm::vec2 pos, int n);
-    uPtr<Chunk>& getNewChunkAt(int x, int z);
 };
@@ -0,0 +1,172 @@
+#include "terraingenerator.h"
+#include "procedureterrain.h"
+#include <algorithm>
+
+void TerrainGenerator::createBlocks(int target_x, int target_z, ChunkBlocks* chunk) {
+    int heights[16 * 16], biomes[16 * 16];
+    ProcedureTerrain::getHeights(target_x, target_z, 16, 16, heights, biomes);
+    for (int x = 0; x < 16; ++x) {
+        for (int z = 0; z < 16; ++z) {
+            int height = heights[x * 16 + z];
+            int biome = biomes[x * 16 + z];
+            if (height <= 138 && height >= 128) {
+                for (int w = height + 1; w <= 138; w++) {
+                    chunk->setBlockAt(x, w, z, WATER);
+                }
+            }
+            for (int k = 0; k <= height; k++) {
+                chunk->setBlockAt(x, k, z, generateBlockByHeight(k, height, biome));
+            }
+        }
+    }
+
+    if (caves) {
+        carveCaves(target_x, target_z, chunk);
+    }
+    decorate(target_x, target_z, chunk);
+}
+
+// Does a feature anchored at world x (or z) reach into the strip of
+// chunks at 320, which is kept clear of trees?
+static bool reachesTreeFreeStrip(int c) {
+    return c + TerrainGenerator::FEATURE_REACH >= 320 && c - TerrainGenerator::FEATURE_REACH < 320 + 16;
+}
+
+std::vector<Feature> TerrainGenerator::featuresInRegion(int regionX, int regionZ) {
+    std::vector<Feature> features;
+    for (int x = regionX; x < regionX + 16; ++x) {
+        for (int z = regionZ; z < regionZ + 16; ++z) {
+            if (ProcedureTerrain::hashColumn(x, z, TREE_SALT) % 500 != 0) {
+                continue;
+            }
+            // The strips of chunks at x = 320 and z = 320 stay clear of
+            // trees, canopies included
+            if (reachesTreeFreeStrip(x) || reachesTreeFreeStrip(z)) {
+                continue;
+            }
+            // Trees grow on GRASS that is not under water
+            int isGrass;
+            int height = ProcedureTerrain::getHeight(x, z, &isGrass);
+            if (isGrass && height >= 138 && height < 142) {
+                features.push_back(Feature{Feature::TREE, x, height, z});
+            }
+        }
+    }
+    return features;
+}
+
+void TerrainGenerator::decorate(int target_x, int target_z, ChunkBlocks* chunk) {
+    std::vector<Feature> features;
+    for (int dx = -16; dx <= 16; dx += 16) {
+        for (int dz = -16; dz <= 16; dz += 16) {
+            std::vector<Feature> region = featuresInRegion(target_x + dx, target_z + dz);
+            features.insert(features.end(), region.begin(), region.end());
+        }
+    }
+    // Every chunk a feature reaches must place overlapping features in
+    // the same order, or they would disagree on which one wins
+    std::sort(features.begin(), features.end(), [](const Feature &a, const Feature &b) {
+        return a.x != b.x ? a.x < b.x : a.z < b.z;
+    });
+
+    for (const Feature &f : features) {
+        if (f.x + FEATURE_REACH < target_x || f.x - FEATURE_REACH >= target_x + 16
+                || f.z + FEATURE_REACH < target_z || f.z - FEATURE_REACH >= target_z + 16) {
+            continue;
+        }
+        placeFeature(f, glm::ivec3(f.x - target_x, f.y, f.z - target_z), chunk);
+    }
+}
+
+void TerrainGenerator::placeFeature(const Feature &f, glm::ivec3 p, ChunkBlocks* chunk) {
+    switch (f.kind) {
+    case Feature::TREE:
+        chunk->fillBox(p, p + glm::ivec3(0, 2, 0), WOOD);
+        chunk->fillBox(p + glm::ivec3(-1, 3, -1), p + glm::ivec3(1, 7, 1), LEAF);
+        chunk->fillBox(p + glm::ivec3(-2, 4, -2), p + glm::ivec3(2, 4, 2), LEAF);
+        chunk->fillBox(p + glm::ivec3(-3, 5, -3), p + glm::ivec3(3, 5, 3), LEAF);
+        chunk->fillBox(p + glm::ivec3(-2, 6, -2), p + glm::ivec3(2, 6, 2), LEAF);
+        break;
+    }
+}
+
+bool TerrainGenerator::caves = true;
+
+void TerrainGenerator::carveCaves(int target_x, int target_z, ChunkBlocks* chunk) {
+    // Lattice points cover x and z from 0 to 16 and y from 0 up to the
+    // first multiple of CAVE_STEP_Y at or above CAVE_TOP
+    const int cellsXZ = 16 / CAVE_STEP_XZ;
+    const int cellsY = (CAVE_TOP + CAVE_STEP_Y - 1) / CAVE_STEP_Y;
+    const glm::ivec3 count(cellsXZ + 1, cellsY + 1, cellsXZ + 1);
+    float density[(cellsXZ + 1) * (cellsY + 1) * (cellsXZ + 1)];
+    ProcedureTerrain::getCaveDensities(glm::ivec3(target_x, 0, target_z), count,
+                                       glm::ivec3(CAVE_STEP_XZ, CAVE_STEP_Y, CAVE_STEP_XZ), density);
+    auto corner = [&](int i, int k, int j) {
+        return density[(i * count.z + j) * count.y + k];
+    };
+
+    for (int cx = 0; cx < cellsXZ; cx++) {
+        for (int cz = 0; cz < cellsXZ; cz++) {
+            for (int cy = 0; cy < cellsY; cy++) {
+                float d000 = corner(cx, cy, cz), d100 = corner(cx + 1, cy, cz);
+                float d001 = corner(cx, cy, cz + 1), d101 = corner(cx + 1, cy, cz + 1);
+                float d010 = corner(cx, cy + 1, cz), d110 = corner(cx + 1, cy + 1, cz);
+                float d011 = corner(cx, cy + 1, cz + 1), d111 = corner(cx + 1, cy + 1, cz + 1);
+                // The interpolated density never drops below its corners,
+                // so a cell with no negative corner has no cave in it
+                if (std::min({d000, d100, d001, d101, d010, d110, d011, d111}) >= 0) {
+                    continue;
+                }
+
+                for (int dx = 0; dx < CAVE_STEP_XZ; dx++) {
+                    float tx = float(dx) / CAVE_STEP_XZ;
+                    for (int dz = 0; dz < CAVE_STEP_XZ; dz++) {
+                        float tz = float(dz) / CAVE_STEP_XZ;
+                        float bottom = glm::mix(glm::mix(d000, d100, tx), glm::mix(d001, d101, tx), tz);
+                        float top = glm::mix(glm::mix(d010, d110, tx), glm::mix(d011, d111, tx), tz);
+                        int x = cx * CAVE_STEP_XZ + dx;
+                        int z = cz * CAVE_STEP_XZ + dz;
+                        for (int dy = 0; dy < CAVE_STEP_Y; dy++) {
+                            int y = cy * CAVE_STEP_Y + dy;
+                            // Keep the bedrock floor
+                            if (y < 1 || y >= CAVE_TOP) {
+                                continue;
+                            }
+                            if (glm::mix(bottom, top, float(dy) / CAVE_STEP_Y) < 0
+                                    && chunk->getBlockAt(x, y, z) == STONE) {
+                                chunk->setBlockAt(x, y, z, y < LAVA_TOP ? LAVA : EMPTY);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+BlockType TerrainGenerator::generateBlockByHeight(int height, int maxHeight, int isGrass) {
+    if (height == 0) {
+        return BEDROCK;
+    } else if (height <= 128) {
+        // carveCaves hollows this out afterwards
+        return STONE;
+    } else {
+        if (isGrass) {
+            if (height == maxHeight) {
+                return GRASS;
+            } else {
+                return DIRT;
+            }
+        } else {
+            if (maxHeight <= 200) {
+                return STONE;
+            } else {
+                if (height == maxHeight) {
+                    return SNOW;
+                } else {
+                    return STONE;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "chunkblocks.h"
+#include <vector>
+
+// A structure generated on top of the terrain, anchored at a world-space
+// block. Features are listed per 16 x 16 region of the world and may
+// reach up to TerrainGenerator::FEATURE_REACH blocks past it.
+struct Feature {
+    enum Kind : unsigned char {
+        TREE
+    };
+    Kind kind;
+    int x, y, z;
+};
+
+// Fills chunks with the procedurally generated world. Needs no OpenGL,
+// so it can run on worker threads and in the headless benchmark.
+class TerrainGenerator {
+public:
+    // Fills the chunk whose lower-left corner is at world (target_x, target_z)
+    static void createBlocks(int target_x, int target_z, ChunkBlocks* chunk);
+
+    // The features anchored in the 16 x 16 region with lower-left corner
+    // (regionX, regionZ). Only depends on the seed and the coordinates.
+    static std::vector<Feature> featuresInRegion(int regionX, int regionZ);
+    // Writes the parts of the features of this chunk's region and the 8
+    // regions around it that fall inside the chunk. Every chunk places
+    // its share of a feature that crosses chunk borders itself, so no
+    // chunk ever writes into (and has to remesh) its neighbors.
+    static void decorate(int target_x, int target_z, ChunkBlocks* chunk);
+    // Writes feature f anchored at chunk-local p, clipped to the chunk
+    static void placeFeature(const Feature &f, glm::ivec3 p, ChunkBlocks* chunk);
+    // How far a feature may extend from its anchor in x and z
+    static constexpr int FEATURE_REACH = 3;
+
+    // Hollows caves out of the STONE below CAVE_TOP, filling those below
+    // LAVA_TOP with LAVA. The cave density is only evaluated on a lattice
+    // of CAVE_STEP_XZ x CAVE_STEP_Y x CAVE_STEP_XZ cells and trilinearly
+    // interpolated, and cells whose corners are all solid are skipped.
+    static void carveCaves(int target_x, int target_z, ChunkBlocks* chunk);
+    // Set to false to generate the world without caves
+    static bool caves;
+
+    // Salt of the ProcedureTerrain::hashColumn that places trees
+    static constexpr uint32_t TREE_SALT = 0x74726565;
+
+    static constexpr int CAVE_TOP = 50;
+    static constexpr int LAVA_TOP = 25;
+    static constexpr int CAVE_STEP_XZ = 4;
+    static constexpr int CAVE_STEP_Y = 8;
+
+    // generate block type
+    static BlockType generateBlockByHeight(int height, int maxHeight, int isGrass);
+};
@@ -0,0 +1,241 @@
+#include "worldsave.h"
+#include "terraingenerator.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+static int floorDiv(int a, int b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+static int64_t packKey(int x, int z) {
+    return static_cast<int64_t>(static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(z));
+}
+
+// The first byte of a saved chunk
+enum ChunkFormat : uint8_t {
+    FULL_CHUNK, CHUNK_DELTA
+};
+
+// Position of the chunk within its region file
+static glm::ivec2 regionLocal(glm::ivec2 chunkPos) {
+    int cx = floorDiv(chunkPos.x, 16), cz = floorDiv(chunkPos.y, 16);
+    return glm::ivec2(cx - floorDiv(cx, RegionFile::CHUNKS) * RegionFile::CHUNKS,
+                      cz - floorDiv(cz, RegionFile::CHUNKS) * RegionFile::CHUNKS);
+}
+
+bool WorldSave::deltaSaves = false;
+
+WorldSave::WorldSave(const std::string &dir)
+    : m_dir(dir), m_fileMutex(), m_regions(), m_queueMutex(), m_queue(),
+      m_wake(), m_idle(), m_writing(nullptr), m_writingKey(0), m_stopping(false),
+      m_stats(), m_batchChunks(0), m_batchBytes(0), m_batchStart(), m_thread()
+{
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        throw std::runtime_error("Cannot create world directory " + dir + ": " + error.message());
+    }
+    m_thread = std::thread(&WorldSave::ioLoop, this);
+}
+
+WorldSave::~WorldSave() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+RegionFile *WorldSave::regionFor(glm::ivec2 chunkPos, bool create) {
+    int regionX = floorDiv(floorDiv(chunkPos.x, 16), RegionFile::CHUNKS);
+    int regionZ = floorDiv(floorDiv(chunkPos.y, 16), RegionFile::CHUNKS);
+    int64_t key = packKey(regionX, regionZ);
+    auto it = m_regions.find(key);
+    if (it != m_regions.end()) {
+        return it->second.get();
+    }
+    std::string path = m_dir + "/r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".mmr";
+    if (!create && !std::filesystem::exists(path)) {
+        return nullptr;
+    }
+    return (m_regions[key] = mkU<RegionFile>(path)).get();
+}
+
+void WorldSave::save(glm::ivec2 chunkPos, uPtr<ChunkBlocks> blocks) {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_queue.empty() && m_writing == nullptr) {
+            m_batchStart = std::chrono::steady_clock::now();
+        }
+        m_queue[packKey(chunkPos.x, chunkPos.y)] = move(blocks);
+    }
+    m_wake.notify_one();
+}
+
+bool WorldSave::load(glm::ivec2 chunkPos, ChunkBlocks *chunk) {
+    glm::ivec2 local = regionLocal(chunkPos);
+    std::vector<uint8_t> data;
+    try {
+        // Only finding and reading the data holds the locks; decoding it,
+        // and generating the chunk under a delta, can run on every worker
+        // at once
+        std::lock_guard<std::mutex> files(m_fileMutex);
+        {
+            // A queued copy is newer than the one on disk. chunk shares
+            // its sections, which is safe since queued snapshots are
+            // never written.
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            int64_t key = packKey(chunkPos.x, chunkPos.y);
+            auto queued = m_queue.find(key);
+            if (queued != m_queue.end()) {
+                chunk->copyBlocksFrom(*queued->second);
+                return true;
+            }
+            if (m_writing != nullptr && m_writingKey == key) {
+                chunk->copyBlocksFrom(*m_writing);
+                return true;
+            }
+        }
+        RegionFile *region = regionFor(chunkPos, false);
+        if (region == nullptr || !region->read(local.x, local.y, &data)) {
+            return false;
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Cannot load chunk " << chunkPos.x << " " << chunkPos.y << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    try {
+        if (data[0] == FULL_CHUNK) {
+            chunk->deserialize(data.data() + 1, data.size() - 1);
+        } else if (data[0] == CHUNK_DELTA) {
+            TerrainGenerator::createBlocks(chunkPos.x, chunkPos.y, chunk);
+            chunk->applyDelta(data.data() + 1, data.size() - 1);
+        } else {
+            throw std::runtime_error("Unknown chunk format " + std::to_string(data[0]));
+        }
+    } catch (const std::runtime_error &e) {
+        // Generated again instead, from scratch
+        chunk->copyBlocksFrom(ChunkBlocks());
+        std::cerr << "Cannot load chunk " << chunkPos.x << " " << chunkPos.y << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WorldSave::hasChunk(glm::ivec2 chunkPos) {
+    std::lock_guard<std::mutex> files(m_fileMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        int64_t key = packKey(chunkPos.x, chunkPos.y);
+        if (m_queue.count(key) > 0 || (m_writing != nullptr && m_writingKey == key)) {
+            return true;
+        }
+    }
+    glm::ivec2 local = regionLocal(chunkPos);
+    try {
+        RegionFile *region = regionFor(chunkPos, false);
+        return region != nullptr && region->contains(local.x, local.y);
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Cannot open the region of chunk " << chunkPos.x << " " << chunkPos.y << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void WorldSave::flush() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_idle.wait(lock, [this]() { return m_queue.empty() && m_writing == nullptr; });
+}
+
+WorldSave::Stats WorldSave::stats() {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_stats;
+}
+
+void WorldSave::ioLoop() {
+    std::vector<uint8_t> data, delta;
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    while (true) {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+        auto it = m_queue.begin();
+        m_writingKey = it->first;
+        m_writing = move(it->second);
+        m_queue.erase(it);
+        bool last = m_queue.empty();
+        lock.unlock();
+
+        // Encoded without holding either lock; loads read m_writing
+        // until it is on disk
+        glm::ivec2 chunkPos(static_cast<int32_t>(m_writingKey >> 32), static_cast<int32_t>(m_writingKey));
+        data.assign(1, FULL_CHUNK);
+        m_writing->serialize(&data);
+        if (deltaSaves) {
+            ChunkBlocks generated;
+            TerrainGenerator::createBlocks(chunkPos.x, chunkPos.y, &generated);
+            delta.assign(1, CHUNK_DELTA);
+            m_writing->serializeDelta(generated, &delta);
+            // A chunk rebuilt from scratch can be smaller in full
+            if (delta.size() < data.size()) {
+                data.swap(delta);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> files(m_fileMutex);
+            glm::ivec2 local = regionLocal(chunkPos);
+            try {
+                if (data.size() == 1 && data[0] == CHUNK_DELTA) {
+                    // Nothing but generated terrain
+                    RegionFile *region = regionFor(chunkPos, false);
+                    if (region != nullptr) {
+                        region->erase(local.x, local.y);
+                    }
+                    data.clear();
+                } else {
+                    regionFor(chunkPos, true)->write(local.x, local.y, data);
+                }
+                if (last) {
+                    for (auto &[key, r] : m_regions) {
+                        r->flush();
+                    }
+                }
+            } catch (const std::runtime_error &e) {
+                data.clear();
+                std::cerr << "Cannot save chunk " << chunkPos.x << " " << chunkPos.y << ": " << e.what() << std::endl;
+            }
+            lock.lock();
+            m_writing = nullptr;
+        }
+
+        m_stats.chunksWritten++;
+        m_stats.bytesWritten += data.size();
+        m_batchChunks++;
+        m_batchBytes += data.size();
+        if (m_queue.empty()) {
+            m_stats.batchChunks = m_batchChunks;
+            m_stats.batchBytes = m_batchBytes;
+            m_stats.batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_batchStart).count();
+            m_batchChunks = 0;
+            m_batchBytes = 0;
+            m_idle.notify_all();
+        }
+    }
+}
+
+bool WorldSave::readSeed(uint32_t *seed) const {
+    std::ifstream in(m_dir + "/seed");
+    return static_cast<bool>(in >> *seed);
+}
+
+void WorldSave::writeSeed(uint32_t seed) const {
+    std::ofstream out(m_dir + "/seed");
+    if (!(out << seed << std::endl)) {
+        throw std::runtime_error("Cannot write the seed of world " + m_dir);
+    }
+}
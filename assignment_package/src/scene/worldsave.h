@@ -0,0 +1,106 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "glm_includes.h"
+#include "chunkblocks.h"
+#include "regionfile.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// A world saved to a directory: one RegionFile per 32 x 32 chunks,
+// named r.<x>.<z>.mmr after the region's coordinates, and a file
+// "seed" holding the ProcedureTerrain::seed the world was made with.
+//
+// Each saved chunk starts with a byte saying how it is stored: all of
+// its blocks (ChunkBlocks::serialize) or, with deltaSaves, only the
+// blocks that differ from what TerrainGenerator makes there
+// (ChunkBlocks::serializeDelta). A delta chunk is loaded by generating
+// the chunk again and applying the delta, so it depends on the seed and
+// on TerrainGenerator staying the same.
+//
+// Chunks are written by an I/O thread owned by the WorldSave, so
+// saving never waits on the disk. Loading is meant to be called from
+// the terrain worker threads and sees chunks that are still queued.
+class WorldSave {
+public:
+    struct Stats {
+        // Since the world was opened
+        uint64_t chunksWritten = 0;
+        uint64_t bytesWritten = 0;
+        // The last batch of saves, from the first chunk queued while the
+        // I/O thread was idle until it had written everything
+        int batchChunks = 0;
+        uint64_t batchBytes = 0;
+        double batchSeconds = 0.0;
+    };
+
+private:
+    std::string m_dir;
+
+    // Guards m_regions. Held while a region file is read or written.
+    // Taken before m_queueMutex when both are needed.
+    std::mutex m_fileMutex;
+    std::unordered_map<int64_t, uPtr<RegionFile>> m_regions;
+
+    // Chunks waiting for the I/O thread, by chunk position. A chunk
+    // saved again before it was written just replaces the queued copy.
+    std::mutex m_queueMutex;
+    std::unordered_map<int64_t, uPtr<ChunkBlocks>> m_queue;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    // The chunk the I/O thread took off the queue, until it is on disk.
+    // Only the I/O thread changes these; it releases m_writing while
+    // holding both mutexes.
+    uPtr<ChunkBlocks> m_writing;
+    int64_t m_writingKey;
+    bool m_stopping;
+    // Guarded by m_queueMutex
+    Stats m_stats;
+    int m_batchChunks;
+    uint64_t m_batchBytes;
+    std::chrono::steady_clock::time_point m_batchStart;
+
+    std::thread m_thread;
+
+    void ioLoop();
+    // The open region file holding the chunk at chunkPos, or nullptr if
+    // it does not exist and create is false. Requires m_fileMutex.
+    RegionFile *regionFor(glm::ivec2 chunkPos, bool create);
+
+public:
+    // Save chunks as edits to the generated terrain, and leave chunks
+    // that were only generated off the disk. Off by default, so saved
+    // chunks load without being generated again.
+    static bool deltaSaves;
+
+    // Opens the world in dir, creating the directory if needed.
+    // Throws std::runtime_error if that fails.
+    explicit WorldSave(const std::string &dir);
+    // Writes every queued chunk, then stops the I/O thread
+    ~WorldSave();
+
+    WorldSave(const WorldSave&) = delete;
+    WorldSave &operator=(const WorldSave&) = delete;
+
+    // Queues the blocks of the chunk whose lower-left corner is at
+    // world chunkPos to be written
+    void save(glm::ivec2 chunkPos, uPtr<ChunkBlocks> blocks);
+    // Replaces the blocks of chunk with the saved blocks at chunkPos.
+    // Returns false, leaving chunk as it was, if that chunk was never
+    // saved or its data is unreadable. Thread-safe.
+    bool load(glm::ivec2 chunkPos, ChunkBlocks *chunk);
+    // Whether the chunk at chunkPos is saved or queued, without reading
+    // it. Thread-safe.
+    bool hasChunk(glm::ivec2 chunkPos);
+    // Blocks until every queued chunk is written
+    void flush();
+    Stats stats();
+
+    // Reads the seed of the world. Returns false for a new world.
+    bool readSeed(uint32_t *seed) const;
+    void writeSeed(uint32_t seed) const;
+};
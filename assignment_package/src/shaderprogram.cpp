@@ -8,7 +8,7 @@
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
     : vertShader(), fragShader(), prog(),
-      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1),
+      attrPos(-1), attrNor(-1), attrCol(-1), attrPosOffset(-1), attrPacked(-1), attrUV(-1),
       unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1),
       unif_sampler2D(-1), unif_time(-1), unif_post_type(-1),
       unif_dimensions(-1), unif_eye(-1),
@@ -69,6 +69,7 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     attrUV = context->glGetAttribLocation(prog, "vs_UV");
     if(attrCol == -1) attrCol = context->glGetAttribLocation(prog, "vs_ColInstanced");
     attrPosOffset = context->glGetAttribLocation(prog, "vs_OffsetInstanced");
+    attrPacked = context->glGetAttribLocation(prog, "vs_Packed");
 
     unifModel      = context->glGetUniformLocation(prog, "u_Model");
     unifModelInvTr = context->glGetUniformLocation(prog, "u_ModelInvTr");
@@ -216,6 +217,11 @@ void ShaderProgram::draw_interleaved(Drawable &d, int texture_slot = 0)
     // (referred to by attrPos) with that VBO
 
     if (d.bindPos()) {
+        // Chunk vertices are two unsigned ints, read as integers
+        if (attrPacked != -1) {
+            context->glEnableVertexAttribArray(attrPacked);
+            context->glVertexAttribIPointer(attrPacked, 2, GL_UNSIGNED_INT, sizeof(glm::uvec2), (void*)0);
+        }
         if (attrPos != -1) {
             context->glEnableVertexAttribArray(attrPos);
             context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
@@ -233,8 +239,9 @@ void ShaderProgram::draw_interleaved(Drawable &d, int texture_slot = 0)
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
-    context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
+    context->glDrawElements(d.drawMode(), d.elemCount(), d.idxType(), 0);
 
+    if (attrPacked != -1) context->glDisableVertexAttribArray(attrPacked);
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
     if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
     if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
@@ -266,6 +273,11 @@ void ShaderProgram::draw_interleaved_transparent(Drawable &d, int texture_slot =
     // (referred to by attrPos) with that VBO
 
     if (d.bind_data_transparent()) {
+        // Chunk vertices are two unsigned ints, read as integers
+        if (attrPacked != -1) {
+            context->glEnableVertexAttribArray(attrPacked);
+            context->glVertexAttribIPointer(attrPacked, 2, GL_UNSIGNED_INT, sizeof(glm::uvec2), (void*)0);
+        }
         if (attrPos != -1) {
             context->glEnableVertexAttribArray(attrPos);
             context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
@@ -283,8 +295,9 @@ void ShaderProgram::draw_interleaved_transparent(Drawable &d, int texture_slot =
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bind_idx_transparent();
-    context->glDrawElements(d.drawMode(), d.elem_count_transparent(), GL_UNSIGNED_INT, 0);
+    context->glDrawElements(d.drawMode(), d.elem_count_transparent(), d.idx_type_transparent(), 0);
 
+    if (attrPacked != -1) context->glDisableVertexAttribArray(attrPacked);
     if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
     if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
     if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
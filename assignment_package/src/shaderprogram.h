@@ -19,6 +19,7 @@ public:
     int attrNor; // A handle for the "in" vec4 representing vertex normal in the vertex shader
     int attrCol; // A handle for the "in" vec4 representing vertex color in the vertex shader
     int attrPosOffset; // A handle for a vec3 used only in the instanced rendering shader
+    int attrPacked; // A handle for the "in" uvec2 holding a packed chunk vertex (see ChunkVBOData)
 
     int attrUV;
 
@@ -1,14 +1,18 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
+# GL-free terrain code, also built on its own as terraincore
+include($$PWD/core.pri)
+
 SOURCES += \
     $$PWD/framebuffer.cpp \
+    $$PWD/framescheduler.cpp \
     $$PWD/inventory.cpp \
     $$PWD/main.cpp \
     $$PWD/mainwindow.cpp \
     $$PWD/mygl.cpp \
     $$PWD/quad.cpp \
-    $$PWD/scene/procedure_terrain.cpp \
+    $$PWD/quadindexbuffer.cpp \
     $$PWD/shaderprogram.cpp \
     $$PWD/drawable.cpp \
     $$PWD/cameracontrolshelp.cpp \
@@ -19,17 +23,19 @@ SOURCES += \
     $$PWD/scene/entity.cpp \
     $$PWD/scene/player.cpp \
     $$PWD/scene/camera.cpp \
+    $$PWD/scene/frustum.cpp \
     $$PWD/playerinfo.cpp \
     $$PWD/scene/chunk.cpp \
     $$PWD/texture.cpp
 
 HEADERS += \
     $$PWD/framebuffer.h \
+    $$PWD/framescheduler.h \
     $$PWD/inventory.h \
     $$PWD/mainwindow.h \
     $$PWD/mygl.h \
     $$PWD/quad.h \
-    $$PWD/scene/procedureterrain.h \
+    $$PWD/quadindexbuffer.h \
     $$PWD/shaderprogram.h \
     $$PWD/drawable.h \
     $$PWD/cameracontrolshelp.h \
@@ -37,11 +43,10 @@ HEADERS += \
     $$PWD/openglcontext.h \
     $$PWD/scene/terrain.h \
     $$PWD/scene/worldaxes.h \
-    $$PWD/smartpointerhelp.h \
-    $$PWD/glm_includes.h \
     $$PWD/scene/entity.h \
     $$PWD/scene/player.h \
     $$PWD/scene/camera.h \
+    $$PWD/scene/frustum.h \
     $$PWD/playerinfo.h \
     $$PWD/scene/chunk.h \
     $$PWD/texture.h
@@ -0,0 +1,117 @@
+#include "threadpool.h"
+
+bool ThreadPool::Job::operator<(const Job &other) const {
+    if (priority != other.priority) {
+        return priority > other.priority;
+    }
+    return sequence > other.sequence;
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+    : m_workers(), m_pending(0), m_wakeMutex(), m_wake(), m_sequence(0), m_stopping(false)
+{
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        m_workers.push_back(mkU<Worker>());
+    }
+    // Start the threads only once every queue exists, since any
+    // worker may try to steal from any other
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        m_workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &w : m_workers) {
+        w->thread.join();
+    }
+    // Drop the jobs that never started; their futures report a broken promise
+    for (auto &w : m_workers) {
+        w->jobs = std::priority_queue<Job>();
+    }
+    m_pending = 0;
+}
+
+unsigned int ThreadPool::size() const {
+    return static_cast<unsigned int>(m_workers.size());
+}
+
+int ThreadPool::pending() const {
+    return m_pending;
+}
+
+void ThreadPool::push(int priority, std::function<void()> run) {
+    uint64_t seq = m_sequence++;
+    // Spread jobs round-robin, so pushes rarely wait on the same queue
+    Worker &w = *m_workers[seq % m_workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.jobs.push(Job{priority, seq, std::move(run)});
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_pending++;
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::tryPop(unsigned int index, Job *job) {
+    while (true) {
+        // Find the queue with the most urgent job at its top. Each queue
+        // is locked only while its top is read.
+        int best = -1;
+        int bestPriority = 0;
+        uint64_t bestSequence = 0;
+        for (unsigned int i = 0; i < m_workers.size(); ++i) {
+            unsigned int w = (index + i) % m_workers.size();
+            std::lock_guard<std::mutex> lock(m_workers[w]->mutex);
+            if (m_workers[w]->jobs.empty()) {
+                continue;
+            }
+            const Job &top = m_workers[w]->jobs.top();
+            if (best < 0 || top.priority < bestPriority ||
+                    (top.priority == bestPriority && top.sequence < bestSequence)) {
+                best = static_cast<int>(w);
+                bestPriority = top.priority;
+                bestSequence = top.sequence;
+            }
+        }
+        if (best < 0) {
+            return false;
+        }
+
+        // The queues may have changed since they were compared. If
+        // another worker emptied this one, compare again; otherwise take
+        // its current top, even if a more urgent job has since been
+        // pushed to another queue.
+        Worker &w = *m_workers[best];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (w.jobs.empty()) {
+            continue;
+        }
+        // top() is const, but the job is popped right after
+        *job = std::move(const_cast<Job&>(w.jobs.top()));
+        w.jobs.pop();
+        m_pending--;
+        return true;
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    while (!m_stopping) {
+        Job job;
+        if (tryPop(index, &job)) {
+            job.run();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this]() { return m_stopping || m_pending > 0; });
+    }
+}
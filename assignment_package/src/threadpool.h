@@ -0,0 +1,83 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run queued jobs, so the terrain
+// pipeline does not pay for creating and joining an OS thread per chunk.
+// Jobs are ordered by priority (lower values run first, ties run in
+// submission order). They are pushed round-robin onto one queue per
+// worker, which only spreads the lock contention: a free worker compares
+// the tops of every queue and pops the most urgent job, so the queues
+// act as one priority queue sharded across the workers. A job pushed
+// while a pop is comparing can be passed over by that pop.
+class ThreadPool {
+private:
+    struct Job {
+        int priority = 0;
+        uint64_t sequence = 0;
+        std::function<void()> run;
+
+        // std::priority_queue keeps the "largest" element on top
+        bool operator<(const Job &other) const;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::priority_queue<Job> jobs;
+        std::thread thread;
+    };
+
+    std::vector<uPtr<Worker>> m_workers;
+
+    // Jobs queued but not yet started, across all workers. Idle
+    // workers sleep on m_wake until this becomes nonzero.
+    std::atomic<int> m_pending;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+
+    std::atomic<uint64_t> m_sequence;
+    std::atomic<bool> m_stopping;
+
+    void workerLoop(unsigned int index);
+    bool tryPop(unsigned int index, Job *job);
+
+public:
+    // Spawns numThreads workers, or one per hardware thread if 0
+    explicit ThreadPool(unsigned int numThreads = 0);
+    // Discards jobs that have not started, waits for the running ones
+    // and joins every worker
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool&) = delete;
+
+    // Queues fn to run on some worker. fn may be move-only.
+    // The returned future becomes ready once fn has run.
+    template<typename F>
+    std::future<void> submit(int priority, F &&fn);
+
+    unsigned int size() const;
+    // Number of jobs waiting to start
+    int pending() const;
+
+private:
+    void push(int priority, std::function<void()> run);
+};
+
+template<typename F>
+std::future<void> ThreadPool::submit(int priority, F &&fn) {
+    // std::function must be copyable, so the (possibly move-only)
+    // task lives behind a shared pointer
+    auto task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(fn));
+    std::future<void> result = task->get_future();
+    push(priority, [task]() { (*task)(); });
+    return result;
+}
@@ -0,0 +1,23 @@
+# The OpenGL-free part of the terrain (block storage, generation,
+# meshing, saving and the worker thread pool) as a static library, so
+# it can be built and profiled without Qt or a display. Build it
+# together with the benchmark and the pregenerator through headless.pro.
+
+TARGET = terraincore
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG += c++1z
+CONFIG -= qt
+CONFIG += warn_on
+CONFIG += release
+DESTDIR = $$OUT_PWD
+
+INCLUDEPATH += include
+
+include(src/core.pri)
+
+*-clang*|*-g++* {
+    CONFIG -= warn_on
+    QMAKE_CXXFLAGS += -Wall -Wextra -pedantic -Winit-self
+    QMAKE_CXXFLAGS += -Wno-strict-aliasing
+}